@@ -5,6 +5,8 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7735.h>
 
+#include "html_template.h"
+
 // ===== TFT pins (NodeMCU / D1 mini) =====
 #define TFT_CS   D2   // GPIO4
 #define TFT_DC   D1   // GPIO5
@@ -46,22 +48,74 @@ static bool parseHexColor(const String& hex, uint8_t &r, uint8_t &g, uint8_t &b)
   return true;
 }
 
+// Что сейчас на экране: /set перерисовывает только изменившуюся область
+struct TextBox { int16_t x, y, w, h; };
+
+static bool     shownValid = false;       // false — на экране чужое (заставка, старт)
+static String   shownText;
+static TextBox  shownBox = { 0, 0, 0, 0 };
+static uint16_t shownFg = 0, shownBg = 0;
+
+// Рамка текста встроенным шрифтом без переноса: 6x8 на символ * size,
+// обрезанная по экрану (длинный msg не переполняет int16_t).
+static TextBox textBox(const String& text, int x, int y, int size) {
+  int32_t w = min<int32_t>((int32_t)text.length() * 6 * size, max<int32_t>(tft.width() - x, 0));
+  int32_t h = min<int32_t>(8 * size, max<int32_t>(tft.height() - y, 0));
+  return { (int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h };
+}
+
+static void fillBox(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c) {
+  if (w <= 0 || h <= 0) return;
+  tft.fillRect(x, y, w, h, c);
+}
+
+// Закрасить части старой рамки, которые новая не закроет (до 4 полос).
+static void clearOutside(const TextBox& o, const TextBox& n, uint16_t bg) {
+  int16_t ox1 = o.x + o.w, oy1 = o.y + o.h;
+  int16_t nx1 = n.x + n.w, ny1 = n.y + n.h;
+  if (n.w <= 0 || n.h <= 0 || nx1 <= o.x || n.x >= ox1 || ny1 <= o.y || n.y >= oy1) {
+    fillBox(o.x, o.y, o.w, o.h, bg);            // не пересекаются
+    return;
+  }
+  int16_t my0 = max(o.y, n.y), my1 = min(oy1, ny1);
+  fillBox(o.x, o.y, o.w, n.y - o.y, bg);          // сверху
+  fillBox(o.x, ny1, o.w, oy1 - ny1, bg);          // снизу
+  fillBox(o.x, my0, n.x - o.x, my1 - my0, bg);    // слева
+  fillBox(nx1, my0, ox1 - nx1, my1 - my0, bg);    // справа
+}
+
 void drawScreen() {
-  // фон
-  tft.fillScreen(rgb565(lastBR, lastBG, lastBB));
+  uint16_t fg = rgb565(lastTR, lastTG, lastTB);
+  uint16_t bg = rgb565(lastBR, lastBG, lastBB);
+  TextBox box = textBox(lastText, lastX, lastY, lastSize);
+
+  bool same = shownValid && fg == shownFg && bg == shownBg && lastText == shownText &&
+              box.x == shownBox.x && box.y == shownBox.y && box.w == shownBox.w && box.h == shownBox.h;
+  if (same) return;   // ничего не изменилось
+
+  // fg == bg: Adafruit_GFX рисует текст прозрачным, ячейки не закрашиваются
+  if (!shownValid || bg != shownBg || fg == bg) {
+    tft.fillScreen(bg);                         // новый фон — весь экран
+  } else {
+    clearOutside(shownBox, box, bg);            // остальное закроет сам текст
+  }
 
-  // текст
+  // текст с фоном: ячейки символов закрашиваются целиком
   tft.setTextWrap(false);
   tft.setCursor(lastX, lastY);
   tft.setTextSize(lastSize);
-  // фон текста = фон экрана, чтобы "переписывалось" аккуратно
-  tft.setTextColor(rgb565(lastTR, lastTG, lastTB), rgb565(lastBR, lastBG, lastBB));
+  tft.setTextColor(fg, bg);
   tft.print(lastText);
+
+  shownValid = true;
+  shownText = lastText;
+  shownBox = box;
+  shownFg = fg;
+  shownBg = bg;
 }
 
-String pageHtml() {
-  // Простая страница управления
-  String html =
+// Простая страница управления: шаблон в PROGMEM, значения подставляет pageVar()
+static const char PAGE_HTML[] PROGMEM =
     "<!doctype html><html><head><meta charset='utf-8'>"
     "<meta name='viewport' content='width=device-width, initial-scale=1'>"
     "<title>ESP8266 TFT</title>"
@@ -83,22 +137,22 @@ String pageHtml() {
     "<form action='/set' method='get'>"
 
     "<label>Текст</label>"
-    "<input name='msg' value='" + lastText + "'>"
+    "<input name='msg' value='{{text}}'>"
 
     "<div class='row'><div>"
-    "<label>X</label><input type='number' name='x' min='0' max='200' value='" + String(lastX) + "'>"
+    "<label>X</label><input type='number' name='x' min='0' max='200' value='{{x}}'>"
     "</div><div>"
-    "<label>Y</label><input type='number' name='y' min='0' max='200' value='" + String(lastY) + "'>"
+    "<label>Y</label><input type='number' name='y' min='0' max='200' value='{{y}}'>"
     "</div><div>"
-    "<label>Size</label><input type='number' name='s' min='1' max='6' value='" + String(lastSize) + "'>"
+    "<label>Size</label><input type='number' name='s' min='1' max='6' value='{{size}}'>"
     "</div></div>"
 
     "<div class='row'><div>"
     "<label>Цвет текста</label>"
-    "<input type='color' name='tc' value='#FFFF00'>"
+    "<input type='color' name='tc' value='{{tc}}'>"
     "</div><div>"
     "<label>Фон</label>"
-    "<input type='color' name='bc' value='#000000'>"
+    "<input type='color' name='bc' value='{{bc}}'>"
     "</div></div>"
 
     "<div style='margin-top:14px'>"
@@ -110,14 +164,21 @@ String pageHtml() {
     "<button type='submit' style='background:#2a3246'>Очистить (чёрный)</button>"
     "</form>"
 
-    "<div class='hint'>Подключись к Wi-Fi <b>" + String(AP_SSID) + "</b> и открой <b>http://192.168.4.1</b></div>"
+    "<div class='hint'>Подключись к Wi-Fi <b>{{ssid}}</b> и открой <b>http://192.168.4.1</b></div>"
     "</div></body></html>";
 
-  return html;
+static void pageVar(HtmlOut& out, const char* name) {
+  if      (!strcmp(name, "text")) out.text(lastText.c_str());
+  else if (!strcmp(name, "x"))    out.num(lastX);
+  else if (!strcmp(name, "y"))    out.num(lastY);
+  else if (!strcmp(name, "size")) out.num(lastSize);
+  else if (!strcmp(name, "tc"))   out.color(lastTR, lastTG, lastTB);
+  else if (!strcmp(name, "bc"))   out.color(lastBR, lastBG, lastBB);
+  else if (!strcmp(name, "ssid")) out.text(AP_SSID);
 }
 
 void handleRoot() {
-  server.send(200, "text/html; charset=utf-8", pageHtml());
+  htmlSendTemplate(server, PAGE_HTML, pageVar);
 }
 
 void handleClear() {
@@ -128,8 +189,20 @@ void handleClear() {
   server.send(302, "text/plain", "OK");
 }
 
+// Одна строка: textBox() не знает переносов, \n и прочие управляющие
+// символы оставили бы на экране незакрашенные пиксели.
+static String oneLine(const String& s) {
+  String out;
+  out.reserve(s.length());
+  for (unsigned i = 0; i < s.length(); i++) {
+    char ch = s[i];
+    if ((uint8_t)ch >= 0x20 && ch != 0x7F) out += ch;
+  }
+  return out;
+}
+
 void handleSet() {
-  if (server.hasArg("msg")) lastText = server.arg("msg");
+  if (server.hasArg("msg")) lastText = oneLine(server.arg("msg"));
   if (server.hasArg("x")) lastX = server.arg("x").toInt();
   if (server.hasArg("y")) lastY = server.arg("y").toInt();
   if (server.hasArg("s")) lastSize = server.arg("s").toInt();
@@ -149,6 +222,8 @@ void handleSet() {
   if (lastSize > 6) lastSize = 6;
   if (lastX < 0) lastX = 0;
   if (lastY < 0) lastY = 0;
+  if (lastX > tft.width())  lastX = tft.width();
+  if (lastY > tft.height()) lastY = tft.height();
 
   drawScreen();
   server.sendHeader("Location", "/");
@@ -0,0 +1,122 @@
+#pragma once
+#include <Arduino.h>
+#include <ESP8266WebServer.h>   // CONTENT_LENGTH_UNKNOWN
+
+// ===== HTML шаблоны из PROGMEM без кучи =====
+// Шаблон — строка в PROGMEM с подстановками {{name}}. Страница уходит
+// chunked-ответом кусками по HTML_CHUNK байт из буфера на стеке:
+// ни один String страницы не собирается, размер страницы не важен.
+//
+// Значения подстановок пишет колбэк:
+//   static void pageVar(HtmlOut& out, const char* name) {
+//     if (!strcmp(name, "text")) out.text(lastText.c_str());   // с экранированием
+//     else if (!strcmp(name, "x")) out.num(lastX);
+//   }
+//   htmlSendTemplate(server, PAGE_HTML, pageVar);
+//
+// {{ в CSS/JS не встречается; одиночные { } и % пишутся как есть.
+
+#ifndef HTML_CHUNK
+  #define HTML_CHUNK 256
+#endif
+#ifndef HTML_VAR_MAX
+  #define HTML_VAR_MAX 16
+#endif
+
+class HtmlOut {
+public:
+  typedef void (*Sink)(void* ctx, const char* data, size_t len);
+
+  HtmlOut(Sink sink, void* ctx) : _sink(sink), _ctx(ctx) {}
+
+  void put(char ch) {
+    if (_n == sizeof(_buf)) flush();
+    _buf[_n++] = ch;
+  }
+
+  void raw(const char* s) { while (*s) put(*s++); }
+
+  // Текст пользователя: безопасен и в теле, и в атрибуте value='...'.
+  void text(const char* s) {
+    for (; *s; s++) {
+      switch (*s) {
+        case '&':  raw("&amp;");  break;
+        case '<':  raw("&lt;");   break;
+        case '>':  raw("&gt;");   break;
+        case '"':  raw("&quot;"); break;
+        case '\'': raw("&#39;");  break;
+        default:   put(*s);
+      }
+    }
+  }
+
+  void num(long v) {
+    char t[12];
+    snprintf(t, sizeof(t), "%ld", v);
+    raw(t);
+  }
+
+  // Строка внутри JSON "...": экранируем " и \, управляющие символы пропускаем.
+  void json(const char* s) {
+    for (; *s; s++) {
+      if (*s == '"' || *s == '\\') put('\\');
+      if ((uint8_t)*s >= 0x20) put(*s);
+    }
+  }
+
+  // "#RRGGBB" для <input type='color'>
+  void color(uint8_t r, uint8_t g, uint8_t b) {
+    char t[8];
+    snprintf(t, sizeof(t), "#%02X%02X%02X", r, g, b);
+    raw(t);
+  }
+
+  void flush() {
+    if (_n) _sink(_ctx, _buf, _n);
+    _n = 0;
+  }
+
+private:
+  Sink   _sink;
+  void*  _ctx;
+  char   _buf[HTML_CHUNK];
+  size_t _n = 0;
+};
+
+typedef void (*HtmlVar)(HtmlOut& out, const char* name);
+
+static void htmlRender(HtmlOut& out, PGM_P tpl, HtmlVar var) {
+  char name[HTML_VAR_MAX];
+  PGM_P p = tpl;
+  for (char ch = pgm_read_byte(p); ch; ch = pgm_read_byte(++p)) {
+    if (ch != '{' || pgm_read_byte(p + 1) != '{') { out.put(ch); continue; }
+
+    // {{name}}
+    uint8_t n = 0;
+    p += 2;
+    for (ch = pgm_read_byte(p); ch && !(ch == '}' && pgm_read_byte(p + 1) == '}'); ch = pgm_read_byte(++p)) {
+      if (n < sizeof(name) - 1) name[n++] = ch;
+    }
+    name[n] = 0;
+    if (!ch) break;          // незакрытая подстановка — конец шаблона
+    p++;                     // p на второй '}'
+    if (var) var(out, name);
+  }
+}
+
+// Sink для HtmlOut: куски уходят в chunked-ответ сервера.
+template<class Server>
+static void htmlServerSink(void* s, const char* data, size_t len) {
+  ((Server*)s)->sendContent(data, len);
+}
+
+// Отдать шаблон chunked-ответом 200.
+template<class Server>
+static void htmlSendTemplate(Server& server, PGM_P tpl, HtmlVar var) {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/html; charset=utf-8", "");
+  HtmlOut out(htmlServerSink<Server>, &server);
+  htmlRender(out, tpl, var);
+  out.flush();
+  server.sendContent("");
+}
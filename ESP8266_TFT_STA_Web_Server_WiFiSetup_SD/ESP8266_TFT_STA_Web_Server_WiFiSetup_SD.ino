@@ -1,5 +1,5 @@
 #include <ESP8266WiFi.h>
-#include <ESP8266WebServer.h>
+#include "web_server.h"
 
 #include <SPI.h>
 #include <Adafruit_GFX.h>
@@ -9,6 +9,18 @@
 #include "app_routes.h"
 #include "sd_test.h"
 #include "sd_browser.h"   // он сам тянет img_draw.h
+#include "ws_control.h"
+#include "udp_control.h"
+#include "group_sync.h"
+#include "metrics.h"
+#include "trace.h"
+#include "draw_batch.h"
+#include "http_keepalive.h"
+#include "sse_events.h"
+#include "config_log.h"
+#include "panel_config.h"
+#include "boot_profile.h"
+#include "spi_bus.h"
 
 // ===== TFT pins =====
 #define TFT_CS   D2
@@ -16,39 +28,71 @@
 #define TFT_RST  -1
 
 Adafruit_ST7735 tft(TFT_CS, TFT_DC, TFT_RST);
-ESP8266WebServer server(80);
+PanelWebServer server(80);
 
 void setup() {
+  bootProfileStart();
   Serial.begin(115200);
   delay(200);
   Serial.println("\nBOOT OK");
 
-  SPI.begin();
-  SPI.setFrequency(4000000);
+  // 0) Настройки из flash: экран, папки, Wi-Fi сети
+  cfgLogBegin();
+  panelConfigLoad();
+  bootPhaseDone(BP_CONFIG);
 
-  tft.initR(INITR_BLACKTAB);   // если надо — GREENTAB / REDTAB
-  tft.setRotation(1);
+  // своя частота у TFT и SD (spi_bus.h), общей SPI.setFrequency нет
+  spiBusBegin(tft);
+
+  tft.initR(panelDisplay.tab);   // BLACKTAB по умолчанию; GREENTAB / REDTAB — POST /api/config?tab=
+  spiBusTftReady(panelDisplay.spiMHz * 1000000UL);   // 0 — самотест частоты
+  tft.setRotation(panelDisplay.rotation);
   tft.fillScreen(ST77XX_BLACK);
-  SD_init(tft);
-  delay(1500);  // чтобы увидеть "SD OK/FAIL"
-  // 1) Wi-Fi provisioning: AP first time, then STA
-  bool staReady = ensureWiFi(server, tft);
-
-  // 2) If STA is ready -> start main app (router control)
-  if (staReady) {
-    setupAppRoutes(server, tft);
-    registerSdBrowserRoutes();
-    server.begin();
-
-    Serial.print("APP IP: ");
-    Serial.println(WiFi.localIP());
-  }
-
-  // Если staReady==false, значит сейчас открыт AP портал,
-  // server уже запущен внутри ensureWiFi().
+  bootPhaseDone(BP_TFT);
+  sdBegin(!FAST_BOOT);   // карта монтируется при первом обращении
+  bootPhaseDone(BP_SD);
+  // 1) Wi-Fi: только запуск подключения (или портала), без ожидания
+  wifiProvisionBegin(server, tft);
+  bootPhaseDone(BP_WIFI_BEGIN);
+
+  // 2) Веб-приложение сразу: SD браузер и управление работают и через точку доступа
+  bootProfileBegin(server);
+  metricsBegin(server);
+  traceBegin(server);
+  keepAliveBegin(server);
+  setupAppRoutes(server, tft);
+  registerSdBrowserRoutes();
+  registerDrawBatchRoute(server, tft);
+  sseEventsBegin(server);
+  panelConfigRoutes(server);
+  spiBusRoutes(server);
+  server.begin();
+  wsControlBegin(tft);
+  bootPhaseDone(BP_ROUTES);
+}
+
+// Сетевые службы, которым нужен IP в сети роутера (UDP, multicast)
+static void startStaServices() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  udpControlBegin(server, tft);
+  groupSyncBegin(server, tft);
+
+  Serial.print("APP IP: ");
+  Serial.println(WiFi.localIP());
 }
 
 void loop() {
-  server.handleClient();
+  if (wifiProvisionLoop()) startStaServices();
+  metricsHandleClient(server);   // = server.handleClient() + замер запроса
+  traceRequestEnd();
+  keepAlivePoll(server);
+  sseEventsLoop();
+  sdPoll();               // card-detect, если есть SD_CD_PIN
+  wsControlLoop();
+  udpControlLoop();
+  groupSyncLoop();
   wifiResetButtonPoll();   // удержать 3 сек -> сброс + рестарт
 }
\ No newline at end of file
@@ -1,61 +1,18 @@
 #pragma once
-#include <ESP8266WebServer.h>
+#include "web_server.h"
 #include <Adafruit_ST7735.h>
 
-// ---- “более похожие на знак” стрелки ----
-static inline uint16_t blueRoad(Adafruit_ST7735& tft) {
-  return tft.color565(0, 80, 200);
-}
-
-static inline void signLeft(Adafruit_ST7735& tft) {
-  tft.fillScreen(ST77XX_BLACK);
-  tft.fillCircle(80, 64, 55, blueRoad(tft));
-
-  // тело стрелки
-  tft.fillRect(58, 58, 48, 12, ST77XX_WHITE);
-  // голова
-  tft.fillTriangle(48, 64, 62, 50, 62, 78, ST77XX_WHITE);
-}
-
-static inline void signRight(Adafruit_ST7735& tft) {
-  tft.fillScreen(ST77XX_BLACK);
-  tft.fillCircle(80, 64, 55, blueRoad(tft));
-  tft.fillRect(54, 58, 48, 12, ST77XX_WHITE);
-  tft.fillTriangle(112, 64, 98, 50, 98, 78, ST77XX_WHITE);
-}
+#include "sign_model.h"
+#include "wifi_provision.h"
 
-static inline void signBack(Adafruit_ST7735& tft) {
-  // “назад/разворот” – упрощенно: стрелка вниз с крюком
-  tft.fillScreen(ST77XX_BLACK);
-  tft.fillCircle(80, 64, 55, blueRoad(tft));
-  // вертикальное тело
-  tft.fillRect(74, 40, 12, 40, ST77XX_WHITE);
-  // голова вниз
-  tft.fillTriangle(80, 88, 62, 70, 98, 70, ST77XX_WHITE);
-  // “крюк” влево
-  tft.fillRect(52, 40, 34, 12, ST77XX_WHITE);
-  tft.fillTriangle(48, 46, 60, 34, 60, 58, ST77XX_WHITE);
-}
-
-static inline void signGreen(Adafruit_ST7735& tft) {
-  tft.fillScreen(ST77XX_BLACK);
-  // зелёный круг (как разрешение)
-  tft.fillCircle(80, 64, 55, tft.color565(0, 160, 60));
-  // белая стрелка вверх
-  tft.fillRect(74, 48, 12, 40, ST77XX_WHITE);
-  tft.fillTriangle(80, 32, 60, 56, 100, 56, ST77XX_WHITE);
-}
-
-static inline void signStop(Adafruit_ST7735& tft) {
-  tft.fillScreen(ST77XX_BLACK);
-  // красный круг (запрещающий)
-  tft.fillCircle(80, 64, 55, tft.color565(200, 0, 0));
-  // белый крест
-  for (int i = -22; i <= 22; i++) {
-    tft.drawLine(80-22, 64-22+i, 80+22, 64+22+i, ST77XX_WHITE);
-    tft.drawLine(80-22, 64+22-i, 80+22, 64-22-i, ST77XX_WHITE);
-  }
-}
+// ---- “более похожие на знак” стрелки ----
+// Геометрия знаков — в sign_model.h; при переключении между знаками
+// перерисовываются только отличающиеся слои.
+static inline void signLeft(Adafruit_ST7735& tft)  { signShow(tft, SIGN_LEFT);  }
+static inline void signRight(Adafruit_ST7735& tft) { signShow(tft, SIGN_RIGHT); }
+static inline void signBack(Adafruit_ST7735& tft)  { signShow(tft, SIGN_BACK);  }  // “назад/разворот”
+static inline void signGreen(Adafruit_ST7735& tft) { signShow(tft, SIGN_GO);    }
+static inline void signStop(Adafruit_ST7735& tft)  { signShow(tft, SIGN_STOP);  }
 
 static inline String controlPage() {
   return R"rawliteral(
@@ -87,35 +44,92 @@ static inline String controlPage() {
       <h2>🚦 TFT Traffic Panel</h2>
 
       <div class="grid">
-        <button onclick="hit('/left')">⬅</button>
-        <button onclick="hit('/right')">➡</button>
-        <button onclick="hit('/back')">↩</button>
+        <button onclick="sign('left')">⬅</button>
+        <button onclick="sign('right')">➡</button>
+        <button onclick="sign('back')">↩</button>
       </div>
 
       <div class="row">
-        <button class="go" onclick="hit('/go')">🟢 GO</button>
-        <button class="stop" onclick="hit('/stop')">❌ STOP</button>
+        <button class="go" onclick="sign('go')">🟢 GO</button>
+        <button class="stop" onclick="sign('stop')">❌ STOP</button>
       </div>
 
       <div class="row">
-        <button class="clear" onclick="hit('/clear')">Clear</button>
+        <button class="clear" onclick="sign('blank','/clear')">Clear</button>
         <button class="clear" onclick="location.href='/'">Reload</button>
+        <button class="clear" onclick="bench()">Latency</button>
       </div>
 
+      <div class="hint" id="st">…</div>
       <div class="hint">Works in router (STA) mode. Open this page from phone or PC.</div>
     </div>
 
     <script>
-      async function hit(p){
-        try{ await fetch(p); }catch(e){}
+      // WebSocket (порт 81), если не подключён — старый fetch
+      let ws=null, seq=0, cur='', last='';
+      const wait={};
+      const st=document.getElementById('st');
+      function show(){ st.textContent=(ws&&ws.readyState===1?'WS':'HTTP')+' | sign: '+(cur||'-')+(last?' | '+last:''); }
+
+      function connect(){
+        ws=new WebSocket('ws://'+location.hostname+':81/');
+        ws.onmessage=e=>{
+          const m=e.data.split(' ');
+          if(m[0]==='a'&&wait[m[1]]){ wait[m[1]](m[2]==='ok'); delete wait[m[1]]; }
+          if(m[0]==='S'){ cur=m.slice(1).join(' '); show(); }
+        };
+        ws.onopen=show;
+        ws.onclose=()=>{
+          for(const k in wait){ wait[k](false); delete wait[k]; }
+          show(); setTimeout(connect,2000);
+        };
       }
+
+      // команда по WS с ожиданием ack; время — до ack
+      function wsCmd(c){
+        return new Promise(res=>{
+          const id=String(++seq);
+          wait[id]=res;
+          ws.send(id+' '+c);
+        });
+      }
+
+      async function sign(name,path){
+        const t=performance.now();
+        if(ws&&ws.readyState===1) await wsCmd('s '+name);
+        else { try{ await fetch(path||('/'+name)); }catch(e){} }
+        last=(performance.now()-t).toFixed(1)+' ms';
+        show();
+      }
+
+      // ping по WS против fetch('/api/ping'): медиана и p90 из 20
+      function stat(a){ a.sort((x,y)=>x-y); return 'med '+a[a.length>>1].toFixed(1)+' p90 '+a[Math.floor(a.length*.9)].toFixed(1); }
+      async function bench(){
+        const N=20, w=[], h=[];
+        for(let i=0;i<N;i++){
+          let t=performance.now();
+          try{ await fetch('/api/ping',{cache:'no-store'}); }catch(e){}
+          h.push(performance.now()-t);
+          if(ws&&ws.readyState===1){ t=performance.now(); await wsCmd('p'); w.push(performance.now()-t); }
+        }
+        last='fetch '+stat(h)+(w.length?' / ws '+stat(w):'')+' ms';
+        show();
+      }
+
+      connect();
     </script>
   </body></html>
   )rawliteral";
 }
 
-static inline void setupAppRoutes(ESP8266WebServer& server, Adafruit_ST7735& tft) {
-  server.on("/", [&](){ server.send(200, "text/html", controlPage()); });
+static inline void setupAppRoutes(PanelWebServer& server, Adafruit_ST7735& tft) {
+  server.on("/", [&](){
+    if (wifiPortalActive()) { wifiSendSetupPage(server); return; }   // режим настройки Wi-Fi
+    server.send(200, "text/html", controlPage());
+  });
+
+  // пустой ответ — замер задержки HTTP на странице (кнопка Latency)
+  server.on("/api/ping", [&](){ server.send(200, "text/plain", "pong"); });
 
   server.on("/left",  [&](){ signLeft(tft);  server.send(200, "text/plain", "OK"); });
   server.on("/right", [&](){ signRight(tft); server.send(200, "text/plain", "OK"); });
@@ -125,7 +139,17 @@ static inline void setupAppRoutes(ESP8266WebServer& server, Adafruit_ST7735& tft
   server.on("/stop",  [&](){ signStop(tft);  server.send(200, "text/plain", "OK"); });
 
   server.on("/clear", [&](){
-    tft.fillScreen(ST77XX_BLACK);
+    signShow(tft, SIGN_BLANK);
     server.send(200, "text/plain", "CLEARED");
   });
+
+  // любой знак по имени: встроенный display list или /signs/<name>.sgn на SD
+  server.on("/api/sign", [&](){
+    String name = server.arg("name");
+    if (!signShowByName(tft, name)) { server.send(404, "text/plain", "No sign"); return; }
+    server.send(200, "text/plain", "OK");
+  });
+
+  // счётчики SPI по примитивам (fast_gfx.h)
+  server.on("/api/gfx", [&](){ server.send(200, "application/json", fgStatsJson()); });
 }
\ No newline at end of file
@@ -0,0 +1,507 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncTCP.h>        // библиотека ESPAsyncTCP (me-no-dev)
+#include <ESP8266WebServer.h>   // только типы: HTTPMethod, HookFunction, CONTENT_LENGTH_*
+#include <SD.h>
+
+// ===== Асинхронный HTTP сервер на колбэках lwIP =====
+// Приём идёт в колбэках ESPAsyncTCP: каждое соединение копит свой
+// запрос, медленный телефон никого не держит. Обработчики маршрутов
+// вызываются из handleClient() в loop() — как у ESP8266WebServer, по
+// одному запросу за вызов, с тем же API (arg, send, sendContent,
+// streamFile...), поэтому существующие обработчики не меняются.
+// SD и SPI трогаются только из loop(), в колбэках — лишь буферы.
+//
+// Состояния соединения:
+//   READ  — копим запрос (колбэк onData)
+//   READY — запрос целиком в буфере, ждёт handleClient()
+//   SEND  — ответ уходит по мере места в окне TCP (и файл для streamFile)
+//   CLOSING — закрыли сами, ждём onDisconnect
+// Затем keep-alive: снова READ (конвейерный запрос может уже лежать
+// в буфере) или закрытие по HTTP_MAX_REQ_PER_CONN / HTTP_IDLE_MS.
+
+// sd_test.h подключается позже (сам тянет web_server.h через spi_bus.h)
+static bool     sdEnsure();
+static bool     sdIoFailed();
+static uint32_t sdMountGen();
+
+#ifndef APS_MAX_CONN
+  #define APS_MAX_CONN 4
+#endif
+#ifndef APS_MAX_ROUTES
+  #define APS_MAX_ROUTES 40
+#endif
+#ifndef APS_MAX_HOOKS
+  #define APS_MAX_HOOKS 4
+#endif
+#ifndef APS_MAX_ARGS
+  #define APS_MAX_ARGS 12
+#endif
+#ifndef APS_MAX_REQ
+  #define APS_MAX_REQ 4096        // заголовки + тело
+#endif
+#ifndef APS_OUT_MAX
+  #define APS_OUT_MAX 4096        // больше — обработчик ждёт подтверждений
+#endif
+
+class AsyncPanelServer {
+public:
+  typedef ESP8266WebServer::THandlerFunction THandlerFunction;
+  typedef ESP8266WebServer::HookFunction     HookFunction;
+
+  explicit AsyncPanelServer(uint16_t port = 80) : _srv(port) {}
+
+  void begin() {
+    _srv.onClient([](void* self, AsyncClient* c) { ((AsyncPanelServer*)self)->onClient(c); }, this);
+    _srv.setNoDelay(true);
+    _srv.begin();
+  }
+
+  // ---- регистрация (как у ESP8266WebServer) ----
+  AsyncPanelServer& on(const String& uri, THandlerFunction fn) { return on(uri, HTTP_ANY, fn); }
+  AsyncPanelServer& on(const String& uri, HTTPMethod method, THandlerFunction fn) {
+    if (_routeN < APS_MAX_ROUTES) _routes[_routeN++] = { uri, method, fn };
+    panelRouteAdd(uri);                // web_server.h: пути для метрик и трассировки
+    return *this;
+  }
+  void onNotFound(THandlerFunction fn) { _notFound = fn; }
+  // Хук получает client == nullptr: WiFiClient здесь нет. Хуки, которым
+  // нужен собеседник (http_keepalive.h), под PANEL_ASYNC_SERVER не ставятся.
+  void addHook(HookFunction fn) { if (_hookN < APS_MAX_HOOKS) _hooks[_hookN++] = fn; }
+  void keepAlive(bool on) { _keepAlive = on; }
+
+  // ---- текущий запрос ----
+  const String& uri() const   { return _uri; }
+  HTTPMethod method() const   { return _method; }
+  int args() const            { return _argN; }
+  const String& argName(int i) const { return _argName[i]; }
+  const String& arg(int i) const     { return _argVal[i]; }
+  String arg(const String& name) const {
+    for (uint8_t i = 0; i < _argN; i++) if (_argName[i] == name) return _argVal[i];
+    return String();
+  }
+  bool hasArg(const String& name) const {
+    for (uint8_t i = 0; i < _argN; i++) if (_argName[i] == name) return true;
+    return false;
+  }
+
+  // ---- ответ ----
+  void setContentLength(size_t len) { _contentLength = len; }
+  void sendHeader(const String& name, const String& value, bool first = false) {
+    String h = name + ": " + value + "\r\n";
+    _extraHeaders = first ? h + _extraHeaders : _extraHeaders + h;
+  }
+
+  void send(int code, const char* type = nullptr, const String& content = String()) {
+    sendHead(code, type ? type : "text/html", content.length());
+    if (content.length()) sendContent(content);
+  }
+  void send(int code, const String& type, const String& content) { send(code, type.c_str(), content); }
+  void send(int code, const char* type, const char* content)     { send(code, type, String(content)); }
+  void send_P(int code, PGM_P type, PGM_P content)               { send(code, String(FPSTR(type)), String(FPSTR(content))); }
+  void send_P(int code, PGM_P type, PGM_P content, size_t len) {
+    sendHead(code, String(FPSTR(type)).c_str(), len);
+    sendContent_P(content, len);
+  }
+
+  void sendContent(const String& s) { sendContent(s.c_str(), s.length()); }
+  void sendContent(const char* s)   { sendContent(s, strlen(s)); }
+  void sendContent(const char* s, size_t len) {
+    if (!_cur) return;
+    if (_chunked) {
+      char hdr[12];
+      snprintf(hdr, sizeof(hdr), "%x\r\n", (unsigned)len);
+      write(hdr, strlen(hdr));
+      if (len) write(s, len);
+      write("\r\n", 2);
+      if (!len) _chunked = false;     // пустой кусок — конец ответа
+    } else {
+      write(s, len);
+    }
+  }
+  void sendContent_P(PGM_P s)             { sendContent_P(s, strlen_P(s)); }
+  void sendContent_P(PGM_P s, size_t len) {
+    char buf[128];
+    for (size_t i = 0; i < len; i += sizeof(buf)) {
+      size_t n = min(sizeof(buf), len - i);
+      memcpy_P(buf, s + i, n);
+      sendContent(buf, n);
+    }
+  }
+
+  // Файл отдаётся из handleClient() по мере места в окне TCP.
+  // Обработчик закрывает свой File сразу после вызова — открываем свой,
+  // как и всё обращение к SD: через sdEnsure() (монтирование и шина).
+  template<class T>
+  size_t streamFile(T& file, const String& type, HTTPMethod = HTTP_GET) {
+    if (!_cur) return 0;
+    File f;
+    if (sdEnsure()) f = SD.open(file.fullName(), FILE_READ);
+    if (!f || !f.seek(file.position())) {
+      if (f) f.close();
+      else sdIoFailed();
+      send(500, "text/plain", "SD read error");
+      return 0;
+    }
+    size_t size = file.size() - file.position();
+    _contentLength = size;
+    sendHead(200, type.c_str(), size);
+    _cur->file = f;
+    _cur->fileGen = sdMountGen();
+    return size;
+  }
+
+  // Забрать соединение текущего запроса себе (поток событий SSE):
+  // сервер о нём забывает, колбэки и delete — на вызывающем.
+  AsyncClient* detachClient() {
+    if (!_cur || !_cur->c) return nullptr;
+    AsyncClient* c = _cur->c;
+    c->onData(nullptr, nullptr);
+    c->onDisconnect(nullptr, nullptr);
+    _cur->c = nullptr;
+    _cur->st = C_DEAD;
+    _headSent = true;     // ответ пишет новый владелец
+    return c;
+  }
+
+  // ---- loop(): отправка, таймауты, один запрос обработчику ----
+  void handleClient() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < APS_MAX_CONN; i++) {
+      Conn& k = _conns[i];
+      if (k.st == C_FREE) continue;
+      if (k.st == C_DEAD) { release(k); continue; }
+      if (k.st == C_SEND) pump(k);
+      if (k.st == C_READ && now - k.lastMs > HTTP_IDLE_MS) { _stats.closedIdle++; closeConn(k); }
+    }
+
+    // один запрос за вызов, по кругу — никто не ждёт бесконечно
+    for (uint8_t n = 0; n < APS_MAX_CONN; n++) {
+      _rr = (_rr + 1) % APS_MAX_CONN;
+      if (_conns[_rr].st == C_READY) { dispatch(_conns[_rr]); break; }
+    }
+  }
+
+  String connStatsJson() const {
+    uint8_t open = 0;
+    for (const Conn& k : _conns) if (k.st != C_FREE) open++;
+    String s = "{";
+    s += "\"async\":true";
+    s += ",\"keepalive\":" + String(_keepAlive ? "true" : "false");
+    s += ",\"idle_ms\":" + String(HTTP_IDLE_MS);
+    s += ",\"max_req\":" + String(HTTP_MAX_REQ_PER_CONN);
+    s += ",\"open\":" + String(open);
+    s += ",\"conns\":" + String(_stats.conns);
+    s += ",\"reqs\":" + String(_stats.reqs);
+    s += ",\"refused\":" + String(_stats.refused);
+    s += ",\"closed_idle\":" + String(_stats.closedIdle);
+    s += ",\"closed_cap\":" + String(_stats.closedCap);
+    s += "}";
+    return s;
+  }
+
+private:
+  enum CState : uint8_t { C_FREE, C_READ, C_READY, C_SEND, C_CLOSING, C_DEAD };
+
+  struct Conn {
+    AsyncClient* c = nullptr;
+    CState   st = C_FREE;
+    String   rx;             // принятые, но не разобранные байты
+    String   out;            // ответ, ещё не отданный в TCP
+    size_t   outPos = 0;
+    File     file;
+    uint32_t fileGen = 0;    // номер монтирования SD, на котором открыт file
+    bool     close = false;  // закрыть после ответа
+    uint16_t reqs = 0;
+    uint32_t lastMs = 0;
+  };
+
+  struct Route {
+    String           uri;
+    HTTPMethod       method;
+    THandlerFunction fn;
+  };
+
+  struct Stats {
+    uint32_t conns, reqs, refused, closedIdle, closedCap;
+  };
+
+  // ---- колбэки lwIP: только буферы и состояния ----
+  void onClient(AsyncClient* c) {
+    Conn* k = nullptr;
+    for (Conn& x : _conns) if (x.st == C_FREE) { k = &x; break; }
+    if (!k) { _stats.refused++; c->close(true); delete c; return; }
+
+    _stats.conns++;
+    k->c = c;
+    k->st = C_READ;
+    k->rx = "";
+    k->reqs = 0;
+    k->close = false;
+    k->lastMs = millis();
+    c->setNoDelay(true);
+    c->onData([](void* p, AsyncClient*, void* data, size_t len) { onRx(*(Conn*)p, (const char*)data, len); }, k);
+    c->onDisconnect([](void* p, AsyncClient* c) { ((Conn*)p)->c = nullptr; ((Conn*)p)->st = C_DEAD; delete c; }, k);
+    c->onTimeout([](void*, AsyncClient* c, uint32_t) { c->close(true); }, nullptr);
+  }
+
+  // Буфер ограничен APS_MAX_REQ в любом состоянии: клиент может слать
+  // и во время ответа (конвейер). Переполнение — закрыть соединение.
+  static void onRx(Conn& k, const char* data, size_t len) {
+    k.lastMs = millis();
+    if (k.st == C_CLOSING || k.st == C_DEAD) return;
+    if (k.rx.length() + len > APS_MAX_REQ) { closeConn(k); return; }
+    k.rx.concat(data, len);
+    if (k.st == C_READ && requestLen(k.rx) != REQ_PARTIAL) k.st = C_READY;
+  }
+
+  // Длина первого полного запроса в буфере, REQ_PARTIAL — ещё не весь,
+  // REQ_BAD — Content-Length не число или не влезает в APS_MAX_REQ
+  // (границу запроса не знаем — только 400 и закрыть).
+  static const int REQ_PARTIAL = -1;
+  static const int REQ_BAD = -2;
+
+  static int requestLen(const String& rx) {
+    int end = rx.indexOf("\r\n\r\n");
+    if (end < 0) return REQ_PARTIAL;
+    int len = 0;
+    int p = indexOfNoCase(rx, "\r\ncontent-length:", end);
+    if (p >= 0) {
+      String v = rx.substring(p + 17, rx.indexOf('\r', p + 2));
+      v.trim();
+      if (!v.length() || v.length() > 5) return REQ_BAD;
+      for (unsigned i = 0; i < v.length(); i++) if (v[i] < '0' || v[i] > '9') return REQ_BAD;
+      len = v.toInt();
+    }
+    int total = end + 4 + len;
+    if (total > APS_MAX_REQ) return REQ_BAD;
+    return (int)rx.length() >= total ? total : REQ_PARTIAL;
+  }
+
+  static int indexOfNoCase(const String& s, const char* what, int limit) {
+    size_t n = strlen(what);
+    for (int i = 0; i + (int)n <= limit + 2; i++) {
+      if (strncasecmp(s.c_str() + i, what, n) == 0) return i;
+    }
+    return -1;
+  }
+
+  // Слот освобождается только в onDisconnect: до него lwIP ещё может
+  // позвать колбэки с этим Conn.
+  static void closeConn(Conn& k) {
+    k.st = C_CLOSING;
+    k.c->close();
+  }
+
+  // ---- loop() ----
+  void release(Conn& k) {
+    if (k.file) k.file.close();
+    k.rx = "";
+    k.out = "";
+    k.outPos = 0;
+    k.st = C_FREE;
+  }
+
+  // Отдать в TCP сколько влезет: сначала out, потом файл.
+  void pump(Conn& k) {
+    if (!k.c) return;
+    while (k.outPos < k.out.length() && k.c->space()) {
+      size_t n = min((size_t)k.c->space(), k.out.length() - k.outPos);
+      k.c->add(k.out.c_str() + k.outPos, n);
+      k.outPos += n;
+    }
+    if (k.outPos >= k.out.length()) { k.out = ""; k.outPos = 0; }
+
+    if (!k.out.length() && k.file && k.st == C_SEND) {
+      // между вызовами шину мог взять TFT, а карту — перемонтировать;
+      // Content-Length уже ушёл, поэтому при сбое только закрыть соединение
+      bool ok = sdEnsure() && k.fileGen == sdMountGen();
+      uint8_t buf[512];
+      while (ok && k.file.available() && k.c->space() >= sizeof(buf)) {
+        int n = k.file.read(buf, sizeof(buf));
+        if (n <= 0) { sdIoFailed(); ok = false; break; }
+        k.c->add((const char*)buf, n);
+      }
+      if (!ok) { k.file.close(); k.c->send(); closeConn(k); return; }
+      if (!k.file.available()) k.file.close();
+    }
+    k.c->send();
+
+    // конец ответа — только когда обработчик уже вернулся
+    if (k.st == C_SEND && &k != _cur && !k.out.length() && !k.file) finish(k);
+  }
+
+  void finish(Conn& k) {
+    if (k.close || !_keepAlive) { closeConn(k); return; }
+    k.st = C_READ;
+    k.lastMs = millis();
+    if (requestLen(k.rx) != REQ_PARTIAL) k.st = C_READY;   // конвейер
+  }
+
+  void write(const char* s, size_t len) {
+    Conn& k = *_cur;
+    if (!k.c) return;
+    k.out.concat(s, len);
+    pump(k);
+    // обработчик пишет больше, чем уходит: ждём подтверждений
+    uint32_t t0 = millis();
+    while (k.c && k.out.length() - k.outPos > APS_OUT_MAX && millis() - t0 < 5000) {
+      yield();
+      pump(k);
+    }
+  }
+
+  void sendHead(int code, const char* type, size_t len) {
+    if (!_cur || _headSent) return;
+    _headSent = true;
+    String h = "HTTP/1.1 " + String(code) + " " + reason(code) + "\r\n";
+    h += "Content-Type: " + String(type) + "\r\n";
+    if (_contentLength == CONTENT_LENGTH_UNKNOWN) {
+      _chunked = true;
+      h += "Transfer-Encoding: chunked\r\n";
+    } else {
+      h += "Content-Length: " + String(_contentLength == CONTENT_LENGTH_NOT_SET ? len : _contentLength) + "\r\n";
+    }
+    h += _cur->close || !_keepAlive ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+    h += _extraHeaders;
+    h += "\r\n";
+    write(h.c_str(), h.length());
+  }
+
+  static const char* reason(int code) {
+    switch (code) {
+      case 200: return "OK";
+      case 204: return "No Content";
+      case 302: return "Found";
+      case 400: return "Bad Request";
+      case 404: return "Not Found";
+      case 413: return "Payload Too Large";
+      case 500: return "Internal Server Error";
+      default:  return code < 400 ? "OK" : "Error";
+    }
+  }
+
+  static String urlDecode(const String& s) {
+    String out;
+    for (unsigned i = 0; i < s.length(); i++) {
+      char ch = s[i];
+      if (ch == '+') ch = ' ';
+      else if (ch == '%' && i + 2 < s.length()) { ch = (char)strtol(s.substring(i + 1, i + 3).c_str(), nullptr, 16); i += 2; }
+      out += ch;
+    }
+    return out;
+  }
+
+  void parseArgs(const String& q) {
+    int p = 0;
+    while (p < (int)q.length() && _argN < APS_MAX_ARGS) {
+      int amp = q.indexOf('&', p);
+      if (amp < 0) amp = q.length();
+      int eq = q.indexOf('=', p);
+      if (eq < 0 || eq > amp) eq = amp;
+      if (amp > p) {
+        _argName[_argN] = urlDecode(q.substring(p, eq));
+        _argVal[_argN] = eq < amp ? urlDecode(q.substring(eq + 1, amp)) : String();
+        _argN++;
+      }
+      p = amp + 1;
+    }
+  }
+
+  static HTTPMethod methodOf(const String& m) {
+    if (m == "GET")    return HTTP_GET;
+    if (m == "POST")   return HTTP_POST;
+    if (m == "PUT")    return HTTP_PUT;
+    if (m == "DELETE") return HTTP_DELETE;
+    if (m == "HEAD")   return HTTP_HEAD;
+    return HTTP_ANY;
+  }
+
+  void beginResponse(Conn& k) {
+    _cur = &k;
+    _headSent = false;
+    _chunked = false;
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _extraHeaders = "";
+    k.st = C_SEND;
+  }
+
+  // Неверный Content-Length: остаток буфера не разобрать — 400 и закрыть.
+  void reject(Conn& k) {
+    k.rx = "";
+    k.close = true;
+    beginResponse(k);
+    send(400, "text/plain", "Bad Content-Length");
+    _cur = nullptr;
+    if (k.c) pump(k);
+  }
+
+  void dispatch(Conn& k) {
+    int total = requestLen(k.rx);
+    if (total == REQ_BAD) { reject(k); return; }
+    int end = k.rx.indexOf("\r\n\r\n");
+    String head = k.rx.substring(0, end);
+    String body = k.rx.substring(end + 4, total);
+    k.rx = k.rx.substring(total);
+
+    // "GET /path?query HTTP/1.1"
+    int sp1 = head.indexOf(' '), sp2 = head.indexOf(' ', sp1 + 1);
+    int eol = head.indexOf('\r');
+    String methodStr = head.substring(0, sp1);
+    String url = head.substring(sp1 + 1, sp2);
+    bool http10 = head.substring(sp2 + 1, eol < 0 ? head.length() : eol) == "HTTP/1.0";
+
+    _method = methodOf(methodStr);
+    int q = url.indexOf('?');
+    _uri = q < 0 ? url : url.substring(0, q);
+    _argN = 0;
+    if (q >= 0) parseArgs(url.substring(q + 1));
+    bool form = indexOfNoCase(head, "\r\ncontent-type: application/x-www-form-urlencoded", head.length()) >= 0;
+    if (form) parseArgs(body);
+    if (body.length() && _argN < APS_MAX_ARGS) { _argName[_argN] = "plain"; _argVal[_argN++] = body; }
+
+    k.reqs++;
+    _stats.reqs++;
+    k.close = http10 || indexOfNoCase(head, "\r\nconnection: close", head.length()) >= 0;
+    if (k.reqs >= HTTP_MAX_REQ_PER_CONN) { k.close = true; _stats.closedCap++; }
+
+    beginResponse(k);
+
+    for (uint8_t i = 0; i < _hookN; i++) _hooks[i](methodStr, _uri, nullptr, nullptr);
+
+    THandlerFunction fn = _notFound;
+    for (uint8_t i = 0; i < _routeN; i++) {
+      const Route& r = _routes[i];
+      if (r.uri == _uri && (r.method == HTTP_ANY || r.method == _method)) { fn = r.fn; break; }
+    }
+    if (fn) fn();
+    else    send(404, "text/plain", "Not found");
+
+    if (!_headSent) send(500, "text/plain", "No response");
+    if (_chunked) sendContent("", 0);
+    _cur = nullptr;
+    if (k.c) pump(k);
+  }
+
+  AsyncServer      _srv;
+  Conn             _conns[APS_MAX_CONN];
+  uint8_t          _rr = 0;
+  Route            _routes[APS_MAX_ROUTES];
+  uint8_t          _routeN = 0;
+  HookFunction     _hooks[APS_MAX_HOOKS];
+  uint8_t          _hookN = 0;
+  THandlerFunction _notFound;
+  bool             _keepAlive = true;
+  Stats            _stats = {};
+
+  Conn*      _cur = nullptr;
+  String     _uri;
+  HTTPMethod _method = HTTP_GET;
+  String     _argName[APS_MAX_ARGS];
+  String     _argVal[APS_MAX_ARGS];
+  uint8_t    _argN = 0;
+  bool       _headSent = false;
+  bool       _chunked = false;
+  size_t     _contentLength = CONTENT_LENGTH_NOT_SET;
+  String     _extraHeaders;
+};
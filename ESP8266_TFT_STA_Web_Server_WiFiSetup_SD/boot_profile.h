@@ -0,0 +1,96 @@
+#pragma once
+#include <Arduino.h>
+#include "web_server.h"
+
+// ===== Профиль загрузки =====
+// Время каждой фазы setup() и шагов подключения Wi-Fi, от сброса до
+// первого обслуженного запроса. Таблица — в Serial при первом запросе,
+// в /metrics — panel_boot_phase_seconds{phase=...} и
+// panel_boot_first_request_seconds.
+//
+// FAST_BOOT 1 — без листинга корня SD в Serial при первом монтировании
+// (содержимое SD — на странице /files). SD монтируется при первом
+// обращении (sd_test.h), загрузку не задерживает.
+
+#ifndef FAST_BOOT
+  #define FAST_BOOT 1
+#endif
+
+enum BootPhase : uint8_t {
+  BP_CORE = 0,          // сброс -> setup(): ROM, SDK, конструкторы
+  BP_CONFIG,            // журнал настроек
+  BP_TFT,               // SPI + initR + очистка экрана
+  BP_SD,                // sdBegin: только пины, карта — при первом обращении
+  BP_WIFI_BEGIN,        // wifiProvisionBegin: кнопка, сети, старт
+  BP_ROUTES,            // маршруты и server.begin()
+  BP_WIFI_FAST,         // шаги автомата wifi_provision (уже в loop)
+  BP_WIFI_SCAN,
+  BP_WIFI_CONNECT,
+  BP_WIFI_PORTAL,
+  BP_COUNT
+};
+
+static const char* const BP_NAMES[BP_COUNT] = {
+  "core", "config", "tft", "sd", "wifi_begin", "routes",
+  "wifi_fast", "wifi_scan", "wifi_connect", "wifi_portal"
+};
+
+static uint32_t bootUs[BP_COUNT];       // длительность фазы; повтор — суммируется
+static uint32_t bootPhaseT0 = 0;
+static int8_t   bootWifi = -1;          // открытый шаг Wi-Fi
+static uint32_t bootWifiT0 = 0;
+static uint32_t bootWifiUpUs = 0;       // сброс -> Wi-Fi подключён
+static uint32_t bootFirstReqUs = 0;     // сброс -> первый запрос
+
+// Первой строкой setup(): время до setup() — фаза core.
+static inline void bootProfileStart() {
+  bootPhaseT0 = micros();
+  bootUs[BP_CORE] = bootPhaseT0;
+}
+
+// Конец фазы setup(): время от конца предыдущей.
+static inline void bootPhaseDone(BootPhase p) {
+  uint32_t now = micros();
+  bootUs[p] += now - bootPhaseT0;
+  bootPhaseT0 = now;
+}
+
+// Шаг Wi-Fi начался; -1 — шаги кончились (подключено).
+static void bootWifiStep(int8_t p) {
+  uint32_t now = micros();
+  if (bootWifi >= 0) bootUs[bootWifi] += now - bootWifiT0;
+  bootWifi = p;
+  bootWifiT0 = now;
+  if (p < 0 && !bootWifiUpUs) bootWifiUpUs = now;
+}
+
+static void bootProfilePrint() {
+  Serial.println("Boot profile:");
+  for (uint8_t i = 0; i < BP_COUNT; i++) {
+    if (bootUs[i]) Serial.printf("  %-12s %6lu ms\n", BP_NAMES[i], (unsigned long)(bootUs[i] / 1000));
+  }
+  if (bootWifiUpUs) Serial.printf("  wifi up at   %6lu ms\n", (unsigned long)(bootWifiUpUs / 1000));
+  Serial.printf("  first request %5lu ms%s\n", (unsigned long)(bootFirstReqUs / 1000),
+                FAST_BOOT ? " (FAST_BOOT)" : "");
+}
+
+static String bootMetricsText() {
+  String s = "# TYPE panel_boot_phase_seconds gauge\n";
+  for (uint8_t i = 0; i < BP_COUNT; i++) {
+    s += "panel_boot_phase_seconds{phase=\"" + String(BP_NAMES[i]) + "\"} " + String(bootUs[i] / 1e6, 3) + "\n";
+  }
+  s += "# TYPE panel_boot_wifi_up_seconds gauge\npanel_boot_wifi_up_seconds " + String(bootWifiUpUs / 1e6, 3) + "\n";
+  s += "# TYPE panel_boot_first_request_seconds gauge\npanel_boot_first_request_seconds " + String(bootFirstReqUs / 1e6, 3) + "\n";
+  return s;
+}
+
+// Хук: первый запрос после загрузки — конец профиля.
+static void bootProfileBegin(PanelWebServer& server) {
+  server.addHook([](const String&, const String&, WiFiClient*, ESP8266WebServer::ContentTypeFunction) {
+    if (!bootFirstReqUs) {
+      bootFirstReqUs = micros();
+      bootProfilePrint();
+    }
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+  });
+}
@@ -0,0 +1,267 @@
+#pragma once
+#include <Arduino.h>
+#include <flash_hal.h>   // FS_PHYS_ADDR / FS_PHYS_SIZE
+
+// ===== Журнал настроек во flash =====
+// Настройки — записи {ключ, версия, длина, seq, crc32} в двух секторах
+// flash. Запись только дописывается в конец активного сектора, старая
+// копия того же ключа просто устаревает. Сектор полон — живые записи
+// переносятся во второй сектор (сжатие), сектора чередуются, так что
+// износ делится на оба, а не на одну ячейку EEPROM.
+//
+// При загрузке сектор читается один раз и строится индекс ключ -> смещение,
+// дальше cfgRead() — одно чтение flash без поиска.
+// cfgWrite() с тем же значением ничего не пишет.
+//
+// Устойчивость к пропаданию питания:
+//  - оборванная запись не проходит crc: она и всё после неё игнорируются,
+//    следующая запись начнётся со сжатия в чистый сектор;
+//  - при сжатии заголовок нового сектора пишется последним: пока его нет,
+//    действует старый сектор.
+//
+// Место: первые CFG_LOG_SECTORS сектора области FS (LittleFS в скетче не
+// используется — файлы на SD). В Arduino IDE нужен Flash Size с FS
+// (например "4MB (FS:1MB ...)"); с "FS:none" журнал выключен и
+// настройки живут только до перезагрузки.
+
+#ifndef CFG_LOG_SECTORS
+  #define CFG_LOG_SECTORS 2
+#endif
+#ifndef CFG_LOG_ADDR
+  #define CFG_LOG_ADDR ((uint32_t)FS_PHYS_ADDR)
+#endif
+#ifndef CFG_REC_MAX
+  #define CFG_REC_MAX 256          // максимум байт значения
+#endif
+
+#define CFG_LOG_MAGIC  0x31474643  // "CFG1"
+
+// Ключи записей. Номер ключа не меняется никогда: новые — в конец.
+enum CfgKey : uint8_t {
+  CFG_WIFI_META = 1,             // wifi_store.h: count, okSeq
+  CFG_WIFI_NET0 = 2,             // wifi_store.h: сети 0..7
+  CFG_DISPLAY   = 10,            // panel_config.h: поворот, tab, SPI
+  CFG_SD_PATHS  = 11,            // panel_config.h: папки на SD
+  CFG_KEY_MAX   = 16
+};
+
+struct CfgSectorHdr {
+  uint32_t magic;
+  uint32_t gen;                  // номер сжатия: больше — новее
+};
+
+struct CfgRecHdr {
+  uint8_t  key;
+  uint8_t  ver;                  // версия структуры значения
+  uint16_t len;
+  uint32_t seq;
+  uint32_t crc;                  // crc32 заголовка (без crc) и значения
+};
+
+static const uint32_t CFG_SECTOR = SPI_FLASH_SEC_SIZE;
+
+struct CfgIdx {
+  uint16_t off;                  // 0 — ключа нет
+  uint16_t len;
+  uint8_t  ver;
+};
+
+static bool     cfgOk = false;
+static uint8_t  cfgActive = 0;   // индекс активного сектора
+static uint32_t cfgGen = 0;
+static uint32_t cfgEnd = 0;      // свободное место от этого смещения
+static uint32_t cfgSeq = 0;
+static bool     cfgTorn = false; // хвост сектора испорчен — писать после сжатия
+static CfgIdx   cfgIdx[CFG_KEY_MAX];
+
+static uint32_t cfgWrites = 0, cfgSkipped = 0, cfgCompactions = 0;
+
+static inline uint32_t cfgAlign(uint32_t n) { return (n + 3) & ~3u; }
+static inline uint32_t cfgAddr(uint8_t sector, uint32_t off) {
+  return CFG_LOG_ADDR + sector * CFG_SECTOR + off;
+}
+
+static uint32_t cfgCrc32(const uint8_t* p, size_t n, uint32_t crc = 0xFFFFFFFF) {
+  while (n--) {
+    crc ^= *p++;
+    for (uint8_t k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return crc;
+}
+
+static uint32_t cfgRecCrc(const CfgRecHdr& h, const uint8_t* data) {
+  return ~cfgCrc32(data, h.len, cfgCrc32((const uint8_t*)&h, offsetof(CfgRecHdr, crc)));
+}
+
+// Запись целиком (заголовок + значение) в выровненном буфере.
+struct CfgRecBuf {
+  CfgRecHdr h;
+  uint32_t  data[CFG_REC_MAX / 4];
+  uint8_t*  bytes() { return (uint8_t*)data; }
+  uint32_t  size() const { return sizeof(CfgRecHdr) + cfgAlign(h.len); }
+};
+
+static bool cfgReadRec(uint8_t sector, uint32_t off, CfgRecBuf& r) {
+  if (!ESP.flashRead(cfgAddr(sector, off), (uint32_t*)&r.h, sizeof(r.h))) return false;
+  if (r.h.key == 0xFF || r.h.len > CFG_REC_MAX) return false;
+  if (off + r.size() > CFG_SECTOR) return false;
+  if (r.h.len && !ESP.flashRead(cfgAddr(sector, off + sizeof(r.h)), r.data, cfgAlign(r.h.len))) return false;
+  return r.h.crc == cfgRecCrc(r.h, r.bytes());
+}
+
+static bool cfgSectorHdr(uint8_t sector, CfgSectorHdr& h) {
+  return ESP.flashRead(cfgAddr(sector, 0), (uint32_t*)&h, sizeof(h)) && h.magic == CFG_LOG_MAGIC;
+}
+
+static bool cfgFormat(uint8_t sector, uint32_t gen) {
+  CfgSectorHdr h = { CFG_LOG_MAGIC, gen };
+  return ESP.flashEraseSector(cfgAddr(sector, 0) / CFG_SECTOR) &&
+         ESP.flashWrite(cfgAddr(sector, 0), (uint32_t*)&h, sizeof(h));
+}
+
+// Пройти активный сектор, собрать индекс и конец журнала.
+static void cfgScan() {
+  memset(cfgIdx, 0, sizeof(cfgIdx));
+  cfgTorn = false;
+  static CfgRecBuf r;
+  uint32_t off = sizeof(CfgSectorHdr);
+  while (off + sizeof(CfgRecHdr) <= CFG_SECTOR) {
+    if (!cfgReadRec(cfgActive, off, r)) {
+      // 0xFF на месте заголовка — чистое место; иначе оборванная запись
+      uint32_t w[sizeof(CfgRecHdr) / 4];
+      ESP.flashRead(cfgAddr(cfgActive, off), w, sizeof(w));
+      for (uint32_t x : w) if (x != 0xFFFFFFFF) cfgTorn = true;
+      break;
+    }
+    if (r.h.key < CFG_KEY_MAX) cfgIdx[r.h.key] = { (uint16_t)off, r.h.len, r.h.ver };
+    if ((int32_t)(r.h.seq - cfgSeq) > 0) cfgSeq = r.h.seq;
+    off += r.size();
+  }
+  cfgEnd = off;
+}
+
+// Из setup() до первого чтения настроек.
+static bool cfgLogBegin() {
+  if (CFG_LOG_ADDR % CFG_SECTOR || (uint32_t)FS_PHYS_SIZE < CFG_LOG_SECTORS * CFG_SECTOR) {
+    Serial.println("Config log: no flash area (choose Flash Size with FS), settings not saved");
+    return cfgOk = false;
+  }
+
+  int best = -1;
+  for (uint8_t s = 0; s < CFG_LOG_SECTORS; s++) {
+    CfgSectorHdr h;
+    if (!cfgSectorHdr(s, h)) continue;
+    if (best < 0 || (int32_t)(h.gen - cfgGen) > 0) { best = s; cfgGen = h.gen; }
+  }
+  if (best < 0) {
+    cfgGen = 1;
+    best = 0;
+    if (!cfgFormat(0, cfgGen)) { Serial.println("Config log: format failed"); return cfgOk = false; }
+    Serial.println("Config log: formatted");
+  }
+  cfgActive = best;
+  cfgOk = true;
+  cfgScan();
+  Serial.printf("Config log: sector %u gen %u, %u/%u bytes%s\n",
+                cfgActive, cfgGen, cfgEnd, CFG_SECTOR, cfgTorn ? ", torn tail" : "");
+  return true;
+}
+
+static bool cfgHas(uint8_t key) {
+  return cfgOk && key < CFG_KEY_MAX && cfgIdx[key].off && cfgIdx[key].len;
+}
+
+// Значение ключа той же версии; короче буфера — остаток нулями
+// (поля, добавленные в конец структуры, получают 0).
+static bool cfgRead(uint8_t key, uint8_t ver, void* out, size_t size) {
+  if (!cfgHas(key) || cfgIdx[key].ver != ver) return false;
+  static CfgRecBuf r;
+  if (!cfgReadRec(cfgActive, cfgIdx[key].off, r)) return false;
+  memset(out, 0, size);
+  memcpy(out, r.bytes(), min<size_t>(size, r.h.len));
+  return true;
+}
+
+// Перенести живые записи в другой сектор.
+static bool cfgCompact() {
+  uint8_t dst = (cfgActive + 1) % CFG_LOG_SECTORS;
+  if (!ESP.flashEraseSector(cfgAddr(dst, 0) / CFG_SECTOR)) return false;
+
+  static CfgRecBuf r;
+  CfgIdx idx[CFG_KEY_MAX] = {};
+  uint32_t off = sizeof(CfgSectorHdr);
+  for (uint8_t k = 0; k < CFG_KEY_MAX; k++) {
+    if (!cfgHas(k)) continue;             // удалённые ключи не переносим
+    if (!cfgReadRec(cfgActive, cfgIdx[k].off, r)) continue;
+    if (!ESP.flashWrite(cfgAddr(dst, off), (uint32_t*)&r, r.size())) return false;
+    idx[k] = { (uint16_t)off, r.h.len, r.h.ver };
+    off += r.size();
+  }
+
+  // заголовок последним: с этого момента действует новый сектор
+  CfgSectorHdr h = { CFG_LOG_MAGIC, cfgGen + 1 };
+  if (!ESP.flashWrite(cfgAddr(dst, 0), (uint32_t*)&h, sizeof(h))) return false;
+
+  cfgActive = dst;
+  cfgGen = h.gen;
+  cfgEnd = off;
+  cfgTorn = false;
+  memcpy(cfgIdx, idx, sizeof(idx));
+  cfgCompactions++;
+  Serial.printf("Config log: compacted to sector %u (gen %u, %u bytes)\n", dst, cfgGen, cfgEnd);
+  return true;
+}
+
+// Дописать значение ключа. len 0 — удалить ключ.
+// Значение не изменилось — true без записи во flash.
+static bool cfgWrite(uint8_t key, uint8_t ver, const void* data, size_t len) {
+  if (!cfgOk || key >= CFG_KEY_MAX || len > CFG_REC_MAX) return false;
+
+  static CfgRecBuf r;
+  if (!cfgHas(key)) {
+    if (!len) { cfgSkipped++; return true; }
+  } else if (cfgIdx[key].ver == ver && cfgIdx[key].len == len &&
+             cfgReadRec(cfgActive, cfgIdx[key].off, r) && !memcmp(r.bytes(), data, len)) {
+    cfgSkipped++;
+    return true;
+  }
+
+  memset(&r, 0xFF, sizeof(r));            // хвост выравнивания = стёртый flash
+  r.h.key = key;
+  r.h.ver = ver;
+  r.h.len = len;
+  r.h.seq = cfgSeq + 1;
+  if (len) memcpy(r.bytes(), data, len);
+  r.h.crc = cfgRecCrc(r.h, r.bytes());
+
+  if (cfgTorn || cfgEnd + r.size() > CFG_SECTOR) {
+    if (!cfgCompact() || cfgEnd + r.size() > CFG_SECTOR) {
+      Serial.println("Config log: no space");
+      return false;
+    }
+  }
+  if (!ESP.flashWrite(cfgAddr(cfgActive, cfgEnd), (uint32_t*)&r, r.size())) {
+    cfgTorn = true;                       // что-то могло записаться
+    return false;
+  }
+  cfgSeq = r.h.seq;
+  cfgIdx[key] = { (uint16_t)cfgEnd, r.h.len, ver };
+  cfgEnd += r.size();
+  cfgWrites++;
+  return true;
+}
+
+static inline bool cfgErase(uint8_t key) { return cfgWrite(key, 0, nullptr, 0); }
+
+static String cfgLogStatsJson() {
+  String s = "{\"ok\":" + String(cfgOk ? "true" : "false");
+  s += ",\"sector\":" + String(cfgActive);
+  s += ",\"gen\":" + String(cfgGen);
+  s += ",\"used\":" + String(cfgEnd);
+  s += ",\"size\":" + String(CFG_SECTOR);
+  s += ",\"seq\":" + String(cfgSeq);
+  s += ",\"writes\":" + String(cfgWrites);
+  s += ",\"skipped\":" + String(cfgSkipped);
+  s += ",\"compactions\":" + String(cfgCompactions) + "}";
+  return s;
+}
@@ -0,0 +1,309 @@
+#pragma once
+#include <Arduino.h>
+#include "web_server.h"
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7735.h>
+
+#include "fast_gfx.h"
+#include "img_draw.h"
+#include "sign_model.h"
+
+// ===== POST /api/draw — пакет команд за один запрос =====
+// Тело — JSON массив примитивов, исполняются по порядку:
+//   {"op":"fill","c":"#000000"}
+//   {"op":"rect","x":0,"y":0,"w":160,"h":20,"c":"#0040FF"}
+//   {"op":"text","x":4,"y":6,"t":"DETOUR","s":1,"c":"#FFFFFF","bg":"#0040FF"}
+//   {"op":"image","file":"/qr/qr_web_128.bmp","x":16,"y":0}
+//   {"op":"sign","name":"left"}
+// Цвет — "#RRGGBB" или число RGB565.
+//
+// Тело сервер копит целиком в arg("plain") (оба сервера), поэтому оно
+// ограничено DB_BODY_MAX — больше 413, без разбора. Разбор по символу,
+// без дерева JSON: команда исполняется, как только закрылась её '}'. Весь пакет идёт в одной SPI-транзакции дисплея;
+// шина отпускается только на чтение SD (image, знак с SD) — SD на той же шине.
+// Текст рисуется через холст-полосу (ST7735 не читается обратно),
+// поэтому у текста всегда есть фон: "bg", по умолчанию чёрный.
+
+#define DB_STR_MAX 64
+#ifndef DB_BODY_MAX
+  #define DB_BODY_MAX 4096        // = APS_MAX_REQ асинхронного сервера
+#endif
+
+struct DrawCmd {
+  char    op[8];
+  char    str[DB_STR_MAX];     // t / file / name
+  int32_t x, y, w, h, s;
+  uint16_t c, bg;
+};
+
+class DrawParser {
+public:
+  typedef bool (*Exec)(const DrawCmd&, void* ctx);
+
+  DrawParser(Exec exec, void* ctx) : _exec(exec), _ctx(ctx) { resetCmd(); }
+
+  // false — ошибка разбора или исполнения (error(), pos())
+  bool feed(char ch) {
+    _pos++;
+    switch (_st) {
+      case ST_START:
+        if (isspace((unsigned char)ch)) return true;
+        if (ch != '[') return fail("expected [");
+        _st = ST_ARRAY;
+        return true;
+
+      case ST_ARRAY:                       // после '[': '{' или ']'
+      case ST_ITEM:                        // после ',': только '{'
+        if (isspace((unsigned char)ch)) return true;
+        if (ch == ']' && _st == ST_ARRAY) { _st = ST_DONE; return true; }
+        if (ch != '{') return fail("expected {");
+        resetCmd();
+        _st = ST_OBJ;
+        return true;
+
+      case ST_ARRAY_NEXT:                  // после '}': ',' или ']'
+        if (isspace((unsigned char)ch)) return true;
+        if (ch == ',') { _st = ST_ITEM; return true; }
+        if (ch == ']') { _st = ST_DONE; return true; }
+        return fail("expected , or ]");
+
+      case ST_OBJ:                         // после '{': '"' ключа или '}'
+      case ST_KEY:                         // после ',': только '"'
+        if (isspace((unsigned char)ch)) return true;
+        if (ch == '}' && _st == ST_OBJ) return execCmd();
+        if (ch != '"') return fail("expected key");
+        _len = 0;
+        _st = ST_KEY_STR;
+        return true;
+
+      case ST_KEY_NEXT:                    // после значения: ',' или '}'
+        if (isspace((unsigned char)ch)) return true;
+        if (ch == ',') { _st = ST_KEY; return true; }
+        if (ch == '}') return execCmd();
+        return fail("expected , or }");
+
+      case ST_KEY_STR:
+        if (ch == '"') { _key[_len] = 0; _st = ST_COLON; return true; }
+        if (_len < sizeof(_key) - 1) _key[_len++] = ch;
+        return true;
+
+      case ST_COLON:
+        if (isspace((unsigned char)ch)) return true;
+        if (ch != ':') return fail("expected :");
+        _st = ST_VALUE;
+        return true;
+
+      case ST_VALUE:
+        if (isspace((unsigned char)ch)) return true;
+        _len = 0;
+        if (ch == '"') { _st = ST_STR; return true; }
+        if (ch == '-' || isdigit((unsigned char)ch)) { _val[_len++] = ch; _st = ST_NUM; return true; }
+        return fail("bad value");
+
+      case ST_STR:
+        if (_esc) { _esc = false; putStr(ch == 'n' ? ' ' : ch); return true; }
+        if (ch == '\\') { _esc = true; return true; }
+        if (ch == '"') { _val[_len] = 0; _st = ST_KEY_NEXT; return setStr(); }
+        putStr(ch);
+        return true;
+
+      case ST_NUM:
+        if (isdigit((unsigned char)ch)) {
+          if (_len < sizeof(_val) - 1) _val[_len++] = ch;
+          return true;
+        }
+        _val[_len] = 0;
+        {
+          long v = strtol(_val, nullptr, 10);   // длинные числа — насыщение, не переполнение
+          setNum((int32_t)constrain(v, -1000000L, 1000000L));
+        }
+        _st = ST_KEY_NEXT;   // символ после числа разбирается как обычно
+        _pos--;
+        return feed(ch);
+
+      case ST_DONE:
+        if (isspace((unsigned char)ch)) return true;
+        return fail("trailing data");
+
+      default:
+        return false;
+    }
+  }
+
+  bool done() const         { return _st == ST_DONE; }
+  const char* error() const { return _err; }
+  uint32_t pos() const      { return _pos; }
+  uint16_t count() const    { return _count; }
+
+private:
+  enum State : uint8_t {
+    ST_START, ST_ARRAY, ST_ITEM, ST_ARRAY_NEXT, ST_OBJ, ST_KEY, ST_KEY_NEXT,
+    ST_KEY_STR, ST_COLON, ST_VALUE, ST_STR, ST_NUM, ST_DONE, ST_ERROR
+  };
+
+  bool fail(const char* e) { _err = e; _st = ST_ERROR; return false; }
+
+  void resetCmd() {
+    memset(&_cmd, 0, sizeof(_cmd));
+    _cmd.s = 1;
+    _cmd.c = ST77XX_WHITE;
+    _cmd.bg = ST77XX_BLACK;
+  }
+
+  void putStr(char ch) { if (_len < sizeof(_val) - 1) _val[_len++] = ch; }
+
+  static uint16_t hexColor(const char* v) {
+    uint32_t rgb = strtoul(v + 1, nullptr, 16);
+    return ((rgb >> 8) & 0xF800) | ((rgb >> 5) & 0x07E0) | ((rgb >> 3) & 0x001F);
+  }
+
+  bool setStr() {
+    if (!strcmp(_key, "op")) { strncpy(_cmd.op, _val, sizeof(_cmd.op) - 1); return true; }
+    if (!strcmp(_key, "t") || !strcmp(_key, "file") || !strcmp(_key, "name")) {
+      strncpy(_cmd.str, _val, sizeof(_cmd.str) - 1);
+      return true;
+    }
+    if (!strcmp(_key, "c") || !strcmp(_key, "bg")) {
+      if (_val[0] != '#') return fail("bad color");
+      (_key[0] == 'c' ? _cmd.c : _cmd.bg) = hexColor(_val);
+    }
+    return true;   // незнакомые поля пропускаем
+  }
+
+  void setNum(int32_t v) {
+    if      (!strcmp(_key, "x"))  _cmd.x = v;
+    else if (!strcmp(_key, "y"))  _cmd.y = v;
+    else if (!strcmp(_key, "w"))  _cmd.w = v;
+    else if (!strcmp(_key, "h"))  _cmd.h = v;
+    else if (!strcmp(_key, "s"))  _cmd.s = v;
+    else if (!strcmp(_key, "c"))  _cmd.c = (uint16_t)v;
+    else if (!strcmp(_key, "bg")) _cmd.bg = (uint16_t)v;
+  }
+
+  bool execCmd() {
+    _st = ST_ARRAY_NEXT;
+    if (!_exec(_cmd, _ctx)) return fail("bad command");
+    _count++;
+    return true;
+  }
+
+  Exec     _exec;
+  void*    _ctx;
+  State    _st = ST_START;
+  DrawCmd  _cmd;
+  char     _key[8];
+  char     _val[DB_STR_MAX];
+  uint8_t  _len = 0;
+  bool     _esc = false;
+  uint32_t _pos = 0;
+  uint16_t _count = 0;
+  const char* _err = "";
+};
+
+// ---- исполнение ----
+
+// Координаты и размеры — в int16_t примитивов только после зажима:
+// иначе "x":65546 рисовал бы на x=10. Запас — как у ws_control.h.
+#define DB_COORD_MARGIN 160
+
+static int16_t dbX(Adafruit_ST7735& tft, int32_t v) { return (int16_t)constrain(v, (int32_t)-DB_COORD_MARGIN, (int32_t)tft.width() + DB_COORD_MARGIN); }
+static int16_t dbY(Adafruit_ST7735& tft, int32_t v) { return (int16_t)constrain(v, (int32_t)-DB_COORD_MARGIN, (int32_t)tft.height() + DB_COORD_MARGIN); }
+
+struct DrawCtx {
+  Adafruit_ST7735& tft;
+  FastGfx&         fg;
+};
+
+// Текст через холст-полосу: фон + символы, один setAddrWindow на полосу.
+static bool dbText(Adafruit_ST7735& tft, const DrawCmd& c) {
+  int16_t size = constrain(c.s, 1, 4);
+  int32_t tw = (int32_t)strlen(c.str) * 6 * size;
+  int32_t th = 8 * size;
+  int16_t cx = dbX(tft, c.x), cy = dbY(tft, c.y);
+  int16_t x0 = max<int32_t>(cx, 0), y0 = max<int32_t>(cy, 0);
+  int16_t x1 = min<int32_t>(cx + tw, tft.width()) - 1;
+  int16_t y1 = min<int32_t>(cy + th, tft.height()) - 1;
+  if (x1 < x0 || y1 < y0) return true;
+
+  int16_t w = x1 - x0 + 1, h = y1 - y0 + 1;
+  int16_t stripH = (h < SIGN_STRIP_H) ? h : SIGN_STRIP_H;
+  GFXcanvas16 strip(w, stripH);
+  if (!strip.getBuffer()) return false;
+  strip.setTextWrap(false);
+  strip.setTextSize(size);
+  strip.setTextColor(c.c);
+
+  for (int16_t sy = 0; sy < h; sy += stripH) {
+    int16_t rows = min<int16_t>(stripH, h - sy);
+    strip.fillScreen(c.bg);
+    strip.setCursor(cx - x0, cy - (y0 + sy));
+    strip.print(c.str);
+    tft.setAddrWindow(x0, y0 + sy, w, rows);
+    tft.writePixels(strip.getBuffer(), (uint32_t)w * rows);
+  }
+  return true;
+}
+
+static bool dbExec(const DrawCmd& c, void* p) {
+  DrawCtx& ctx = *(DrawCtx*)p;
+  Adafruit_ST7735& tft = ctx.tft;
+
+  ctx.fg.resetWindow();   // text/image/знак ставят окно мимо этого FastGfx
+
+  if (!strcmp(c.op, "sign")) {
+    String name(c.str);
+    for (const SignDef& s : SIGN_TABLE) {
+      if (name == s.name) return signShow(tft, s);   // без SD — внутри транзакции
+    }
+    if (!signNameOk(name)) return false;
+    uint8_t d = fgSuspendTx(tft);
+    bool ok = signShowFromSD(tft, name);
+    fgResumeTx(tft, d);
+    return ok;
+  }
+
+  signInvalidate();   // дальше на экране уже не чистый знак
+
+  if (!strcmp(c.op, "fill")) { ctx.fg.fillScreen(c.c); return true; }
+  if (!strcmp(c.op, "rect")) { ctx.fg.fillRect(dbX(tft, c.x), dbY(tft, c.y), dbX(tft, c.w), dbY(tft, c.h), c.c); return true; }
+  if (!strcmp(c.op, "text")) return dbText(tft, c);
+  if (!strcmp(c.op, "image")) {
+    if (!c.str[0] || strstr(c.str, "..")) return false;
+    uint8_t d = fgSuspendTx(tft);
+    bool ok = drawBmpFromSD(c.str, dbX(tft, c.x), dbY(tft, c.y));
+    fgResumeTx(tft, d);
+    return ok;
+  }
+  return false;
+}
+
+static void registerDrawBatchRoute(PanelWebServer& server, Adafruit_ST7735& tft) {
+  server.on("/api/draw", HTTP_POST, [&](){
+    const String& body = server.arg("plain");
+    if (body.length() > DB_BODY_MAX) {
+      server.send(413, "application/json", "{\"ok\":false,\"ops\":0,\"error\":\"body over " + String(DB_BODY_MAX) + " bytes\"}");
+      return;
+    }
+    uint32_t t0 = micros();
+
+    FastGfx fg(tft);
+    DrawCtx ctx = { tft, fg };
+    DrawParser parser(dbExec, &ctx);
+
+    fg.startWrite();
+    bool ok = true;
+    for (unsigned i = 0; ok && i < body.length(); i++) ok = parser.feed(body[i]);
+    fg.endWrite();
+
+    if (ok && !parser.done()) ok = false;
+    String json = "{\"ok\":" + String(ok ? "true" : "false") +
+                  ",\"ops\":" + String(parser.count()) +
+                  ",\"us\":" + String(micros() - t0);
+    if (!ok) {
+      json += ",\"error\":\"" + String(parser.error()[0] ? parser.error() : "unexpected end") +
+              "\",\"at\":" + String(parser.pos());
+    }
+    json += "}";
+    server.send(ok ? 200 : 400, "application/json", json);
+  });
+}
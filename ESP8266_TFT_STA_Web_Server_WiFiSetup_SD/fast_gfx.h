@@ -0,0 +1,367 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7735.h>
+
+#include "spi_bus.h"
+
+// ===== Быстрые примитивы для ST7735 =====
+// Фигура растеризуется в горизонтальные отрезки (spans), отрезки одной
+// строки сливаются, а соседние строки с одинаковым отрезком уходят одним
+// окном CASET/RASET. Пиксели совпадают с Adafruit_GFX один в один.
+//
+//   FastGfx fg(tft);
+//   fg.fillCircle(80, 64, 55, c);          // те же аргументы, что у tft.*
+//   fg.drawThickLine(58, 42, 102, 86, 22, ST77XX_WHITE);
+
+#ifndef FG_MAX_ROWS
+  #define FG_MAX_ROWS 160          // max(width, height) при любом повороте
+#endif
+#ifndef FG_SPANS_PER_ROW
+  #define FG_SPANS_PER_ROW 4
+#endif
+
+enum FgPrim : uint8_t {
+  FG_RECT = 0, FG_CIRCLE, FG_TRI, FG_LINE, FG_BATCH, FG_TABLE,
+  FG_SIGN,        // не примитив: смены знака (signShowLayers), байты SPI — у примитивов
+  FG_PRIM_COUNT
+};
+
+static const char* const FG_PRIM_NAMES[FG_PRIM_COUNT] = { "rect", "circle", "triangle", "line", "batch", "table", "sign" };
+
+// Счётчики байт по SPI на каждый тип примитива (команды отдельно от данных)
+struct FgStats {
+  uint32_t calls;
+  uint32_t windows;
+  uint32_t cmdBytes;
+  uint32_t dataBytes;
+  uint32_t pixels;      // FG_SIGN: перерисовано пикселей (полная — весь экран)
+  uint32_t full;        // FG_SIGN: полных перерисовок
+};
+
+static FgStats fgStats[FG_PRIM_COUNT];
+
+struct FgSpan {
+  int16_t x0, x1;
+};
+
+// буфер отрезков общий для всех FastGfx (одновременно рисует один)
+static uint8_t fg_cnt[FG_MAX_ROWS];
+static FgSpan  fg_rows[FG_MAX_ROWS][FG_SPANS_PER_ROW];
+
+// ---- общая SPI-транзакция дисплея ----
+// Вложенная транзакция TFT на шине spi_bus.h: всё, что рисует через эти
+// функции, вкладывается в одну внешнюю (пакет /api/draw).
+static inline void fgBeginTx(Adafruit_ST7735&) { spiTftBegin(); }
+static inline void fgEndTx(Adafruit_ST7735&)   { spiTftEnd(); }
+
+// Отпустить шину целиком (SD на той же шине) и вернуть обратно.
+static inline uint8_t fgSuspendTx(Adafruit_ST7735&)       { return spiTftSuspend(); }
+static inline void    fgResumeTx(Adafruit_ST7735&, uint8_t d) { spiTftResume(d); }
+
+// _xstart/_ystart у Adafruit_ST77xx protected — берём через указатель на член
+struct FgOffsets : public Adafruit_ST7735 {
+  static int16_t xs(Adafruit_ST7735& t) { return t.*(&FgOffsets::_xstart); }
+  static int16_t ys(Adafruit_ST7735& t) { return t.*(&FgOffsets::_ystart); }
+};
+
+class FastGfx {
+public:
+  explicit FastGfx(Adafruit_ST7735& tft) : _tft(tft) {}
+
+  // ---- тот же API, что у Adafruit_GFX ----
+  void fillScreen(uint16_t color) {
+    fillRect(0, 0, _tft.width(), _tft.height(), color);
+  }
+
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    prim(FG_RECT, color);
+    addRect(x, y, w, h);
+    done();
+  }
+
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    prim(FG_CIRCLE, color);
+    addCircle(x0, y0, r);
+    done();
+  }
+
+  void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                    int16_t x2, int16_t y2, uint16_t color) {
+    prim(FG_TRI, color);
+    addTriangle(x0, y0, x1, y1, x2, y2);
+    done();
+  }
+
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    drawThickLine(x0, y0, x1, y1, 0, color);
+  }
+
+  // Толстая линия = объединение drawLine, сдвинутых на -half..half
+  // по малой оси (как крест в signStop).
+  void drawThickLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                     int16_t half, uint16_t color) {
+    prim(FG_LINE, color);
+    addThickLine(x0, y0, x1, y1, half);
+    done();
+  }
+
+  // ---- пакет: несколько фигур одного цвета за один проход ----
+  void beginBatch(uint16_t color) { prim(FG_BATCH, color); _batch = true; }
+  void endBatch() { _batch = false; done(); }
+
+  // Держать одну SPI-транзакцию на несколько вызовов.
+  void startWrite() {
+    if (_depth++ == 0) {
+      fgBeginTx(_tft);
+      _winX0 = _winX1 = _winY0 = _winY1 = -1;   // окно могли сменить снаружи
+    }
+  }
+  void endWrite()   { if (_depth && --_depth == 0) fgEndTx(_tft); }
+
+  // Окно дисплея сменили в обход FastGfx — CASET/RASET не пропускать.
+  void resetWindow() { _winX0 = _winX1 = _winY0 = _winY1 = -1; }
+
+  // Готовое окно из таблицы (sign_spans.h) — без растеризации.
+  void fillWindow(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    _prim = FG_TABLE;
+    _color = color;
+    startWrite();
+    window(x0, y0, x1, y1);
+    endWrite();
+  }
+
+  // ---- растеризаторы (добавляют в буфер текущего цвета) ----
+  void addRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (w < 0) { x += w + 1; w = -w; }
+    if (h < 0) { y += h + 1; h = -h; }
+    for (int16_t j = 0; j < h; j++) addSpan(y + j, x, x + w - 1);
+  }
+
+  void addCircle(int16_t x0, int16_t y0, int16_t r) {
+    if (r < 0 || r >= FG_MAX_ROWS) return;
+    // полувысота столбца x0±dx — тот же midpoint, что в fillCircleHelper.
+    // Круг Adafruit не симметричен по диагонали (r=1 — это столбик 1x3),
+    // поэтому строки считаем из столбцов, а не зеркалим.
+    static int16_t colH[FG_MAX_ROWS];
+    for (int16_t i = 1; i <= r; i++) colH[i] = -1;
+    colH[0] = r;
+    int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r, px = x, py = y;
+    while (x < y) {
+      if (f >= 0) { y--; ddF_y += 2; f += ddF_y; }
+      x++; ddF_x += 2; f += ddF_x;
+      // столбец может прийти дважды — берём большую высоту
+      if (x < y + 1 && colH[x] < y) colH[x] = y;
+      if (y != py) { if (colH[py] < px) colH[py] = px; py = y; }
+      px = x;
+    }
+    // строка y0±dy: самый дальний столбец, который до неё достаёт
+    int16_t dx = r;
+    for (int16_t dy = 0; dy <= r; dy++) {
+      while (dx > 0 && colH[dx] < dy) dx--;
+      addSpan(y0 - dy, x0 - dx, x0 + dx);
+      if (dy) addSpan(y0 + dy, x0 - dx, x0 + dx);
+    }
+  }
+
+  void addTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    // порт Adafruit_GFX::fillTriangle, вместо writeFastHLine — addSpan
+    // (y 32-битный: y <= y2 при y2 = 32767 иначе не кончается)
+    int16_t a, b;
+    int32_t y, last;
+    if (y0 > y1) { swap16(y0, y1); swap16(x0, x1); }
+    if (y1 > y2) { swap16(y2, y1); swap16(x2, x1); }
+    if (y0 > y1) { swap16(y0, y1); swap16(x0, x1); }
+
+    if (y0 == y2) {
+      a = b = x0;
+      if (x1 < a) a = x1; else if (x1 > b) b = x1;
+      if (x2 < a) a = x2; else if (x2 > b) b = x2;
+      addSpan(y0, a, b);
+      return;
+    }
+
+    int16_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0,
+            dx12 = x2 - x1, dy12 = y2 - y1;
+    int32_t sa = 0, sb = 0;
+
+    last = (y1 == y2) ? y1 : y1 - 1;
+    for (y = y0; y <= last; y++) {
+      a = x0 + sa / dy01;
+      b = x0 + sb / dy02;
+      sa += dx01; sb += dx02;
+      if (a > b) swap16(a, b);
+      addSpan(y, a, b);
+    }
+
+    sa = (int32_t)dx12 * (y - y1);
+    sb = (int32_t)dx02 * (y - y0);
+    for (; y <= y2; y++) {
+      a = x1 + sa / dy12;
+      b = x0 + sb / dy02;
+      sa += dx12; sb += dx02;
+      if (a > b) swap16(a, b);
+      addSpan(y, a, b);
+    }
+  }
+
+  void addThickLine(int16_t ax0, int16_t ay0, int16_t ax1, int16_t ay1, int16_t half) {
+    // Брезенхем как в Adafruit_GFX::writeLine, но только по видимым шагам:
+    // состояние на первом видимом шаге считается сразу, счётчики 32-битные
+    // (int16_t x0 <= x1 при x1 = 32767 не кончается никогда).
+    int32_t x0 = ax0, y0 = ay0, x1 = ax1, y1 = ay1;
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) { swap32(x0, y0); swap32(x1, y1); }
+    if (x0 > x1) { swap32(x0, x1); swap32(y0, y1); }
+    int32_t dx = x1 - x0, dy = abs(y1 - y0);
+    int32_t err = dx / 2;
+    int32_t ystep = (y0 < y1) ? 1 : -1;
+
+    // большая ось — строки экрана (steep) или столбцы
+    int32_t lim = steep ? min<int32_t>(_tft.height(), FG_MAX_ROWS) : _tft.width();
+    int32_t xs = max<int32_t>(x0, 0), xe = min<int32_t>(x1, lim - 1);
+    if (xs > xe || half < 0) return;
+    if (xs > x0) {
+      // k шагов пропущено: y сдвинулся m раз, 0 <= err < dx
+      int64_t n = (int64_t)(xs - x0) * dy - err;
+      int32_t m = n > 0 ? (int32_t)((n + dx - 1) / dx) : 0;
+      y0 += m * ystep;
+      err += m * dx - (xs - x0) * dy;
+    }
+
+    int32_t h = min<int32_t>(_tft.height(), FG_MAX_ROWS);
+    for (int32_t x = xs; x <= xe; x++) {
+      if (steep) {
+        addSpan(x, clamp16(y0 - half), clamp16(y0 + half));
+      } else {
+        int32_t i0 = max<int32_t>(-half, -y0), i1 = min<int32_t>(half, h - 1 - y0);
+        for (int32_t i = i0; i <= i1; i++) addSpan(y0 + i, x, x);
+      }
+      err -= dy;
+      if (err < 0) { y0 += ystep; err += dx; }
+    }
+  }
+
+  // Отрезок [x0..x1] в строке y; пересекающиеся и смежные — сливаются.
+  void addSpan(int16_t y, int16_t x0, int16_t x1) {
+    if (y < 0 || y >= _tft.height() || y >= FG_MAX_ROWS) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 > _tft.width() - 1) x1 = _tft.width() - 1;
+    if (x0 > x1) return;
+
+    uint8_t& n = fg_cnt[y];
+    FgSpan* row = fg_rows[y];
+    for (uint8_t i = 0; i < n; ) {
+      if (row[i].x0 <= x1 + 1 && x0 <= row[i].x1 + 1) {
+        if (row[i].x0 < x0) x0 = row[i].x0;
+        if (row[i].x1 > x1) x1 = row[i].x1;
+        row[i] = row[--n];
+        i = 0;
+      } else {
+        i++;
+      }
+    }
+    if (n == FG_SPANS_PER_ROW) {   // строка переполнена — сбрасываем буфер
+      flush();
+      n = 0;
+    }
+    row[n++] = { x0, x1 };
+    if (y < _yMin) _yMin = y;
+    if (y > _yMax) _yMax = y;
+  }
+
+  // Отправить накопленные отрезки на дисплей.
+  void flush() {
+    if (_yMin > _yMax) return;
+    startWrite();
+
+    for (int16_t y = _yMin; y <= _yMax; y++) {
+      uint8_t n = fg_cnt[y];
+      fg_cnt[y] = 0;
+      if (n == 1) {
+        // одиночный отрезок: тянем окно вниз, пока отрезок тот же
+        FgSpan s = fg_rows[y][0];
+        int16_t y1 = y;
+        while (y1 + 1 <= _yMax && fg_cnt[y1 + 1] == 1 &&
+               fg_rows[y1 + 1][0].x0 == s.x0 && fg_rows[y1 + 1][0].x1 == s.x1) {
+          y1++;
+          fg_cnt[y1] = 0;
+        }
+        window(s.x0, y, s.x1, y1);
+        y = y1;
+      } else {
+        for (uint8_t i = 0; i < n; i++) window(fg_rows[y][i].x0, y, fg_rows[y][i].x1, y);
+      }
+    }
+
+    endWrite();
+    _yMin = INT16_MAX;
+    _yMax = -1;
+  }
+
+private:
+  static void swap16(int16_t& a, int16_t& b) { int16_t t = a; a = b; b = t; }
+  static void swap32(int32_t& a, int32_t& b) { int32_t t = a; a = b; b = t; }
+  static int16_t clamp16(int32_t v) { return (int16_t)constrain(v, (int32_t)INT16_MIN, (int32_t)INT16_MAX); }
+
+  void prim(FgPrim p, uint16_t color) {
+    if (_batch) return;   // внутри пакета счётчики идут в FG_BATCH
+    _prim = p;
+    _color = color;
+    fgStats[p].calls++;
+  }
+
+  void done() {
+    if (!_batch) flush();
+  }
+
+  // Окно на прямоугольник; неизменившиеся CASET/RASET не отправляем.
+  void window(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    FgStats& st = fgStats[_prim];
+    if (x0 != _winX0 || x1 != _winX1) {
+      int16_t o = FgOffsets::xs(_tft);
+      _tft.writeCommand(ST77XX_CASET);
+      _tft.SPI_WRITE32(((uint32_t)(x0 + o) << 16) | (uint16_t)(x1 + o));
+      st.cmdBytes += 1; st.dataBytes += 4;
+      _winX0 = x0; _winX1 = x1;
+    }
+    if (y0 != _winY0 || y1 != _winY1) {
+      int16_t o = FgOffsets::ys(_tft);
+      _tft.writeCommand(ST77XX_RASET);
+      _tft.SPI_WRITE32(((uint32_t)(y0 + o) << 16) | (uint16_t)(y1 + o));
+      st.cmdBytes += 1; st.dataBytes += 4;
+      _winY0 = y0; _winY1 = y1;
+    }
+    uint32_t px = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+    _tft.writeCommand(ST77XX_RAMWR);
+    _tft.writeColor(_color, px);
+    st.cmdBytes += 1;
+    st.dataBytes += px * 2;
+    st.windows++;
+  }
+
+  Adafruit_ST7735& _tft;
+  uint16_t _color = 0;
+  FgPrim   _prim = FG_RECT;
+  bool     _batch = false;
+  uint8_t  _depth = 0;
+  int16_t  _yMin = INT16_MAX, _yMax = -1;
+  int16_t  _winX0 = -1, _winX1 = -1, _winY0 = -1, _winY1 = -1;
+};
+
+// GET /api/gfx — счётчики SPI по примитивам
+static String fgStatsJson() {
+  String out = "[";
+  for (uint8_t i = 0; i < FG_PRIM_COUNT; i++) {
+    if (i) out += ",";
+    out += "{\"prim\":\"" + String(FG_PRIM_NAMES[i]) +
+           "\",\"calls\":" + String(fgStats[i].calls) +
+           ",\"windows\":" + String(fgStats[i].windows) +
+           ",\"cmd_bytes\":" + String(fgStats[i].cmdBytes) +
+           ",\"data_bytes\":" + String(fgStats[i].dataBytes);
+    if (i == FG_SIGN) out += ",\"pixels\":" + String(fgStats[i].pixels) + ",\"full\":" + String(fgStats[i].full);
+    out += "}";
+  }
+  out += "]";
+  return out;
+}
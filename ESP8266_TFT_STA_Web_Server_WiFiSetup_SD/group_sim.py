@@ -0,0 +1,161 @@
+import argparse
+import heapq
+import multiprocessing as mp
+import random
+import socket
+import struct
+import time
+
+# Групповая смена знака (group_sync.h) на одной Linux машине:
+# хост-мастер рассылает маяки и команды, N процессов изображают панели
+# со своим смещением и дрейфом часов и случайной задержкой доставки.
+# Алгоритм узла тот же, что в прошивке: минимум (local - groupUs) по окну маяков.
+#   python group_sim.py --nodes 5 --cmds 20
+# Только мастер для настоящих панелей (узлы не запускаются):
+#   python group_sim.py --master-only --iface 192.168.1.10 --sign left,right
+
+GROUP = "239.1.2.3"
+PORT = 4211
+BEACON = struct.Struct("<2sBBI")            # 8 байт
+CMD = struct.Struct("<2sBBIIBBH")           # 16 байт
+SIGNS = ["left", "right", "back", "go", "stop", "blank",
+         "road_left", "road_right", "road_back", "road_go", "road_cross"]
+
+WINDOW = 8
+U32 = 0xFFFFFFFF
+
+def s32(x):
+    x &= U32
+    return x - (1 << 32) if x & 0x80000000 else x
+
+def mcast_socket(iface, bind):
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(iface))
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    if bind:
+        s.bind(("", PORT))
+        mreq = socket.inet_aton(GROUP) + socket.inet_aton(iface)
+        s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return s
+
+def node(idx, iface, offset_us, drift_ppm, jitter_ms, results, stop):
+    sock = mcast_socket(iface, True)
+    sock.setblocking(False)
+    random.seed(idx)
+
+    def local_us():
+        return int(time.monotonic() * 1e6 * (1 + drift_ppm * 1e-6) + offset_us) & U32
+
+    obs, offset, synced = [], 0, False
+    last_exec, pending = None, None
+    inbox = []   # (время доставки, пакет) — имитация задержки Wi-Fi
+
+    while not stop.is_set():
+        try:
+            while True:
+                data, _ = sock.recvfrom(64)
+                delay = random.expovariate(1.0 / jitter_ms) / 1000 if jitter_ms else 0
+                heapq.heappush(inbox, (time.monotonic() + delay, data))
+        except BlockingIOError:
+            pass
+
+        while inbox and inbox[0][0] <= time.monotonic():
+            _, data = heapq.heappop(inbox)
+            now = local_us()
+            if len(data) == BEACON.size and data[:2] == b"TB":
+                _, _, _, group_us = BEACON.unpack(data)
+                obs = (obs + [s32(now - group_us)])[-WINDOW:]
+                offset = min(obs)
+                synced = True
+            elif len(data) == CMD.size and data[:2] == b"TG":
+                _, _, _, seq, exec_us, sign, _, _ = CMD.unpack(data)
+                if last_exec is not None and s32(exec_us - last_exec) <= 0:
+                    continue
+                if not synced:
+                    continue
+                last_exec = exec_us
+                pending = (seq, (exec_us + offset) & U32)
+
+        if pending and s32(local_us() - pending[1]) >= 0:
+            results.put((idx, pending[0], time.monotonic()))
+            pending = None
+        time.sleep(0.0002)   # период loop() панели
+
+def master(iface, cmds, lead_ms, period, signs, stop_after):
+    sock = mcast_socket(iface, False)
+    t0 = time.monotonic()
+    group_us = lambda: int((time.monotonic() - t0) * 1e6) & U32
+    sent = {}   # seq -> когда должен исполниться (время хоста)
+    next_beacon, next_cmd, seq = 0.0, 2.0, 0   # 2 с на синхронизацию
+    while True:
+        t = time.monotonic() - t0
+        if t >= next_beacon:
+            sock.sendto(BEACON.pack(b"TB", 1, 0, group_us()), (GROUP, PORT))
+            next_beacon += 0.25
+        if seq < cmds and t >= next_cmd:
+            seq += 1
+            exec_us = (group_us() + lead_ms * 1000) & U32
+            name = signs[(seq - 1) % len(signs)]
+            sock.sendto(CMD.pack(b"TG", 1, 0, seq, exec_us, SIGNS.index(name), 0, 0), (GROUP, PORT))
+            sent[seq] = time.monotonic() + lead_ms / 1000
+            next_cmd += period
+        if stop_after and seq >= cmds and t > next_cmd + 0.5:
+            return sent
+        time.sleep(0.001)
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--nodes", type=int, default=4)
+    ap.add_argument("--cmds", type=int, default=10)
+    ap.add_argument("--lead", type=int, default=80, help="запас до исполнения, мс")
+    ap.add_argument("--period", type=float, default=0.5, help="пауза между командами, с")
+    ap.add_argument("--jitter", type=float, default=3.0, help="средняя задержка доставки узлу, мс")
+    ap.add_argument("--drift", type=float, default=50.0, help="разброс дрейфа часов, ppm")
+    ap.add_argument("--iface", default="127.0.0.1")
+    ap.add_argument("--sign", default="left,right")
+    ap.add_argument("--master-only", action="store_true")
+    args = ap.parse_args()
+    signs = args.sign.split(",")
+
+    if args.master_only:
+        master(args.iface, args.cmds, args.lead, args.period, signs, False)
+        return
+
+    results, stop = mp.Queue(), mp.Event()
+    procs = []
+    for i in range(args.nodes):
+        p = mp.Process(target=node, args=(i, args.iface, random.randrange(1 << 32),
+                                          random.uniform(-args.drift, args.drift), args.jitter, results, stop))
+        p.start()
+        procs.append(p)
+    time.sleep(0.3)
+
+    due = master(args.iface, args.cmds, args.lead, args.period, signs, True)
+    stop.set()
+    for p in procs:
+        p.join()
+
+    done = {}
+    while not results.empty():
+        idx, seq, t = results.get()
+        done.setdefault(seq, []).append(t)
+
+    spreads = []
+    print(" seq  nodes  spread ms  late ms (avg)")
+    for seq in sorted(due):
+        ts = done.get(seq, [])
+        if not ts:
+            print(f"{seq:4}  {0:5}")
+            continue
+        spread = (max(ts) - min(ts)) * 1000
+        late = (sum(ts) / len(ts) - due[seq]) * 1000
+        spreads.append(spread)
+        print(f"{seq:4}  {len(ts):5}  {spread:9.2f}  {late:8.2f}")
+    if spreads:
+        s = sorted(spreads)
+        print("spread: p50 %.2f  max %.2f ms" % (s[len(s) // 2], s[-1]))
+
+if __name__ == "__main__":
+    main()
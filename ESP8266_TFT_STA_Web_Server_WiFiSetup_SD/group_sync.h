@@ -0,0 +1,252 @@
+#pragma once
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "web_server.h"
+#include <Adafruit_ST7735.h>
+
+#include "sign_model.h"
+
+// ===== Групповая смена знака (UDP multicast) =====
+// Несколько панелей вдоль полосы меняют знак одновременно: команда
+// рассылается заранее с моментом исполнения по часам группы, каждая
+// панель рисует знак в этот момент по своим часам.
+//
+// Часы группы ведёт мастер (панель с GROUP_MASTER или хост):
+//   маяк    'T' 'B' | ver | 0 | groupUs u32                           (8 байт)
+//   команда 'T' 'G' | ver | 0 | seq u32 | execUs u32 | sign u8 | 0 | dlRef u16   (16 байт)
+//     seq  — номер у отправителя, только для журнала
+//     sign — индекс в SIGN_TABLE или 0xFF (/signs/<dlRef>.sgn), как в udp_control.h
+//
+// Порядок: команда с моментом исполнения не позже уже принятой
+// отбрасывается — так же отсекаются повторы и своя же рассылка.
+//
+// Смещение: по каждому маяку (local - groupUs) = смещение + задержка.
+// Задержка только прибавляется, поэтому берётся минимум за последние
+// GROUP_WINDOW маяков — окно отслеживает дрейф кварцев.
+
+#ifndef GROUP_PORT
+  #define GROUP_PORT 4211
+#endif
+#ifndef GROUP_MASTER
+  #define GROUP_MASTER 0          // 1 — эта панель рассылает маяки
+#endif
+#ifndef GROUP_BEACON_MS
+  #define GROUP_BEACON_MS 250
+#endif
+#ifndef GROUP_WINDOW
+  #define GROUP_WINDOW 8
+#endif
+#ifndef GROUP_LEAD_MS
+  #define GROUP_LEAD_MS 80        // запас времени на доставку команды
+#endif
+#ifndef GROUP_LEAD_MAX_MS
+  #define GROUP_LEAD_MAX_MS 5000  // больше — 400: узлы отбросили бы команды до этого срока
+#endif
+#ifndef GROUP_LATE_US
+  #define GROUP_LATE_US 500000    // опоздание больше — команда пропускается
+#endif
+
+static const IPAddress GROUP_IP(239, 1, 2, 3);
+
+#define GS_VER 1
+
+struct __attribute__((packed)) GsBeacon {
+  uint8_t  magic[2];
+  uint8_t  ver;
+  uint8_t  reserved;
+  uint32_t groupUs;
+};
+
+struct __attribute__((packed)) GsCmd {
+  uint8_t  magic[2];
+  uint8_t  ver;
+  uint8_t  reserved;
+  uint32_t seq;
+  uint32_t execUs;
+  uint8_t  sign;
+  uint8_t  reserved2;
+  uint16_t dlRef;
+};
+
+struct GsStats {
+  uint32_t beacons, cmds, executed, late, skipped, old;
+  int32_t  lastLateUs;    // насколько позже срока нарисован последний знак
+};
+
+static WiFiUDP          gsUdp;
+static Adafruit_ST7735* gsTft = nullptr;
+static GsStats          gsStats;
+
+// смещение local - group (мкс): минимум по окну маяков
+static int32_t  gsObs[GROUP_WINDOW];
+static uint8_t  gsObsN = 0, gsObsPos = 0;
+static int32_t  gsOffset = 0;
+static uint32_t gsLastBeaconMs = 0;
+
+static bool     gsHaveExec = false;
+static uint32_t gsLastExecUs = 0;       // по часам группы
+static uint32_t gsTxSeq = 0;
+
+// одна отложенная команда: новая заменяет старую
+static bool     gsPending = false;
+static uint32_t gsPendingLocalUs = 0;
+static uint8_t  gsPendingSign = 0;
+static uint16_t gsPendingRef = 0;
+
+static inline bool groupSynced() {
+  return GROUP_MASTER || (gsObsN > 0 && millis() - gsLastBeaconMs < GROUP_BEACON_MS * 8);
+}
+
+static inline uint32_t groupNowUs() {
+  return micros() - (uint32_t)gsOffset;
+}
+
+static void gsOnBeacon(const GsBeacon& b, uint32_t localUs) {
+  gsStats.beacons++;
+  gsLastBeaconMs = millis();
+  gsObs[gsObsPos] = (int32_t)(localUs - b.groupUs);
+  gsObsPos = (gsObsPos + 1) % GROUP_WINDOW;
+  if (gsObsN < GROUP_WINDOW) gsObsN++;
+
+  int32_t m = gsObs[0];
+  for (uint8_t i = 1; i < gsObsN; i++) {
+    if (gsObs[i] - m < 0) m = gsObs[i];
+  }
+  gsOffset = m;
+}
+
+static void gsSchedule(uint32_t execUs, uint8_t sign, uint16_t ref) {
+  gsHaveExec = true;
+  gsLastExecUs = execUs;
+  gsPending = true;
+  gsPendingLocalUs = execUs + (uint32_t)gsOffset;
+  gsPendingSign = sign;
+  gsPendingRef = ref;
+}
+
+static void gsOnCmd(const GsCmd& c) {
+  gsStats.cmds++;
+  if (gsHaveExec && (int32_t)(c.execUs - gsLastExecUs) <= 0) { gsStats.old++; return; }
+  if (!groupSynced()) { gsStats.skipped++; return; }
+  // срок дальше GROUP_LEAD_MAX_MS (чужой хост, сбой часов) заблокировал бы
+  // все следующие команды как старые — такую не запоминаем
+  if ((int32_t)(c.execUs - groupNowUs()) > (int32_t)GROUP_LEAD_MAX_MS * 1000) { gsStats.skipped++; return; }
+  gsSchedule(c.execUs, c.sign, c.dlRef);
+}
+
+static void gsExecute() {
+  int32_t late = (int32_t)(micros() - gsPendingLocalUs);
+  if (late < 0) return;
+  gsPending = false;
+
+  if (late > GROUP_LATE_US) { gsStats.skipped++; return; }
+  if (gsPendingSign == 0xFF) signShowFromSD(*gsTft, String(gsPendingRef));
+  else if (gsPendingSign < sizeof(SIGN_TABLE) / sizeof(SIGN_TABLE[0])) signShow(*gsTft, SIGN_TABLE[gsPendingSign]);
+  gsStats.executed++;
+  gsStats.lastLateUs = late;
+  if (late > 2000) gsStats.late++;
+}
+
+// Разослать команду группе (и исполнить у себя в тот же момент).
+static bool groupSend(uint8_t sign, uint16_t ref, uint32_t leadMs) {
+  if (!groupSynced()) return false;
+  uint32_t execUs = groupNowUs() + leadMs * 1000;
+
+  GsCmd c = { { 'T', 'G' }, GS_VER, 0, ++gsTxSeq, execUs, sign, 0, ref };
+  gsUdp.beginPacketMulticast(GROUP_IP, GROUP_PORT, WiFi.localIP());
+  gsUdp.write((const uint8_t*)&c, sizeof(c));
+  gsUdp.endPacket();
+
+  gsSchedule(execUs, sign, ref);
+  return true;
+}
+
+static void gsSendBeacon() {
+  GsBeacon b = { { 'T', 'B' }, GS_VER, 0, (uint32_t)micros() };
+  gsUdp.beginPacketMulticast(GROUP_IP, GROUP_PORT, WiFi.localIP());
+  gsUdp.write((const uint8_t*)&b, sizeof(b));
+  gsUdp.endPacket();
+}
+
+static String groupStatsJson() {
+  String s = "{";
+  s += "\"master\":" + String(GROUP_MASTER ? "true" : "false");
+  s += ",\"synced\":" + String(groupSynced() ? "true" : "false");
+  s += ",\"offset_us\":" + String(gsOffset);
+  s += ",\"beacons\":" + String(gsStats.beacons);
+  s += ",\"cmds\":" + String(gsStats.cmds);
+  s += ",\"executed\":" + String(gsStats.executed);
+  s += ",\"late\":" + String(gsStats.late);
+  s += ",\"skipped\":" + String(gsStats.skipped);
+  s += ",\"old\":" + String(gsStats.old);
+  s += ",\"last_late_us\":" + String(gsStats.lastLateUs);
+  s += "}";
+  return s;
+}
+
+static void groupSyncBegin(PanelWebServer& server, Adafruit_ST7735& tft) {
+  gsTft = &tft;
+  gsUdp.beginMulticast(WiFi.localIP(), GROUP_IP, GROUP_PORT);
+
+  // /api/group?name=left[&lead=80] — знак на всех панелях группы одновременно
+  // /api/group — состояние синхронизации
+  server.on("/api/group", [&](){
+    if (!server.hasArg("name")) { server.send(200, "application/json", groupStatsJson()); return; }
+
+    String name = server.arg("name");
+    uint32_t lead = GROUP_LEAD_MS;
+    if (server.hasArg("lead")) {
+      String v = server.arg("lead");
+      bool ok = v.length() > 0 && v.length() <= 5;
+      for (unsigned i = 0; i < v.length(); i++) if (!isdigit((unsigned char)v[i])) ok = false;
+      if (!ok || v.toInt() > GROUP_LEAD_MAX_MS) { server.send(400, "text/plain", "Bad lead (0.." + String(GROUP_LEAD_MAX_MS) + " ms)"); return; }
+      lead = v.toInt();
+    }
+    int idx = -1;
+    for (size_t i = 0; i < sizeof(SIGN_TABLE) / sizeof(SIGN_TABLE[0]); i++) {
+      if (name == SIGN_TABLE[i].name) { idx = (int)i; break; }
+    }
+    bool num = name.length() > 0;
+    for (unsigned i = 0; i < name.length(); i++) if (!isdigit((unsigned char)name[i])) num = false;
+    if (idx < 0 && !num) { server.send(404, "text/plain", "No sign"); return; }
+
+    if (!groupSend(idx < 0 ? 0xFF : (uint8_t)idx, idx < 0 ? (uint16_t)name.toInt() : 0, lead)) {
+      server.send(503, "text/plain", "Not synced");
+      return;
+    }
+    server.send(200, "text/plain", "OK");
+  });
+
+  Serial.printf("Group sync on 239.1.2.3:%d (%s)\n", GROUP_PORT, GROUP_MASTER ? "master" : "node");
+}
+
+// Из loop(): маяки, приём, исполнение в срок.
+static void groupSyncLoop() {
+  if (!gsTft) return;
+
+  static uint32_t lastBeacon = 0;
+  if (GROUP_MASTER && millis() - lastBeacon >= GROUP_BEACON_MS) {
+    lastBeacon = millis();
+    gsSendBeacon();
+  }
+
+  while (int size = gsUdp.parsePacket()) {
+    uint32_t localUs = micros();
+    uint8_t buf[sizeof(GsCmd)];
+    if (size > (int)sizeof(buf) || gsUdp.read(buf, size) != size) continue;
+    if (buf[0] != 'T' || buf[2] != GS_VER) continue;
+
+    if (buf[1] == 'B' && size == (int)sizeof(GsBeacon) && !GROUP_MASTER) {
+      GsBeacon b;
+      memcpy(&b, buf, sizeof(b));
+      gsOnBeacon(b, localUs);
+    } else if (buf[1] == 'G' && size == (int)sizeof(GsCmd)) {
+      GsCmd c;
+      memcpy(&c, buf, sizeof(c));
+      gsOnCmd(c);
+    }
+  }
+
+  if (gsPending) gsExecute();
+}
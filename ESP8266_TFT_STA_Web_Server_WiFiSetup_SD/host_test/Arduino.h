@@ -0,0 +1,7 @@
+#pragma once
+// Хост-заглушка для host_test: только то, что нужно sign_dl.h / sign_ct.h.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define PROGMEM
@@ -0,0 +1,199 @@
+// Таблицы окон встроенных знаков (SIGN_SPANS) против Adafruit_GFX.
+// Каждый знак рисуется дважды на экран 160x128: окнами из таблицы и
+// портами fillCircle / fillTriangle / fillRect / drawLine из Adafruit_GFX
+// (толстая линия — как signDrawLayer: drawLine со сдвигом по малой оси).
+// Картинки должны совпасть пиксель в пиксель.
+//
+//   g++ -std=c++17 -Ihost_test -I. host_test/sign_spans_test.cpp -o /tmp/sign_spans_test && /tmp/sign_spans_test
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sign_tables.h"
+
+static uint16_t ref[SIGN_SCREEN_H][SIGN_SCREEN_W];
+static uint16_t tab[SIGN_SCREEN_H][SIGN_SCREEN_W];
+
+// ---- порт Adafruit_GFX (drawPixel с отсечением по экрану) ----
+namespace gfx {
+
+static uint16_t color;
+
+static void swap16(int16_t& a, int16_t& b) { int16_t t = a; a = b; b = t; }
+
+static void writePixel(int16_t x, int16_t y) {
+  if (x >= 0 && x < SIGN_SCREEN_W && y >= 0 && y < SIGN_SCREEN_H) ref[y][x] = color;
+}
+
+static void drawFastVLine(int16_t x, int16_t y, int16_t h) {
+  for (int16_t i = 0; i < h; i++) writePixel(x, y + i);
+}
+
+static void drawFastHLine(int16_t x, int16_t y, int16_t w) {
+  for (int16_t i = 0; i < w; i++) writePixel(x + i, y);
+}
+
+static void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+  int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) { swap16(x0, y0); swap16(x1, y1); }
+  if (x0 > x1) { swap16(x0, x1); swap16(y0, y1); }
+  int16_t dx = x1 - x0, dy = abs(y1 - y0);
+  int16_t err = dx / 2;
+  int16_t ystep = (y0 < y1) ? 1 : -1;
+  for (; x0 <= x1; x0++) {
+    if (steep) writePixel(y0, x0);
+    else       writePixel(x0, y0);
+    err -= dy;
+    if (err < 0) { y0 += ystep; err += dx; }
+  }
+}
+
+static void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+  if (x0 == x1) {
+    if (y0 > y1) swap16(y0, y1);
+    drawFastVLine(x0, y0, y1 - y0 + 1);
+  } else if (y0 == y1) {
+    if (x0 > x1) swap16(x0, x1);
+    drawFastHLine(x0, y0, x1 - x0 + 1);
+  } else {
+    writeLine(x0, y0, x1, y1);
+  }
+}
+
+// Adafruit_SPITFT::fillRect (отрицательные w/h разворачиваются)
+static void fillRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  if (w < 0) { x += w + 1; w = -w; }
+  if (h < 0) { y += h + 1; h = -h; }
+  for (int16_t i = x; i < x + w; i++) drawFastVLine(i, y, h);
+}
+
+static void fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t corners, int16_t delta) {
+  int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r, px = x, py = y;
+  delta++;
+  while (x < y) {
+    if (f >= 0) { y--; ddF_y += 2; f += ddF_y; }
+    x++; ddF_x += 2; f += ddF_x;
+    if (x < (y + 1)) {
+      if (corners & 1) drawFastVLine(x0 + x, y0 - y, 2 * y + delta);
+      if (corners & 2) drawFastVLine(x0 - x, y0 - y, 2 * y + delta);
+    }
+    if (y != py) {
+      if (corners & 1) drawFastVLine(x0 + py, y0 - px, 2 * px + delta);
+      if (corners & 2) drawFastVLine(x0 - py, y0 - px, 2 * px + delta);
+      py = y;
+    }
+    px = x;
+  }
+}
+
+static void fillCircle(int16_t x0, int16_t y0, int16_t r) {
+  drawFastVLine(x0, y0 - r, 2 * r + 1);
+  fillCircleHelper(x0, y0, r, 3, 0);
+}
+
+static void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+  int16_t a, b, y, last;
+  if (y0 > y1) { swap16(y0, y1); swap16(x0, x1); }
+  if (y1 > y2) { swap16(y2, y1); swap16(x2, x1); }
+  if (y0 > y1) { swap16(y0, y1); swap16(x0, x1); }
+
+  if (y0 == y2) {
+    a = b = x0;
+    if (x1 < a) a = x1; else if (x1 > b) b = x1;
+    if (x2 < a) a = x2; else if (x2 > b) b = x2;
+    drawFastHLine(a, y0, b - a + 1);
+    return;
+  }
+
+  int16_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0,
+          dx12 = x2 - x1, dy12 = y2 - y1;
+  int32_t sa = 0, sb = 0;
+
+  last = (y1 == y2) ? y1 : y1 - 1;
+  for (y = y0; y <= last; y++) {
+    a = x0 + sa / dy01;
+    b = x0 + sb / dy02;
+    sa += dx01; sb += dx02;
+    if (a > b) swap16(a, b);
+    drawFastHLine(a, y, b - a + 1);
+  }
+
+  sa = (int32_t)dx12 * (y - y1);
+  sb = (int32_t)dx02 * (y - y0);
+  for (; y <= y2; y++) {
+    a = x1 + sa / dy12;
+    b = x0 + sb / dy02;
+    sa += dx12; sb += dx02;
+    if (a > b) swap16(a, b);
+    drawFastHLine(a, y, b - a + 1);
+  }
+}
+
+} // namespace gfx
+
+// display list -> ref, как signDrawLayer
+template<size_t N>
+static void drawRef(const uint8_t (&dl)[N]) {
+  for (auto& row : ref) for (auto& px : row) px = SIGN_BG;
+  gfx::color = ST77XX_WHITE;
+  size_t i = 0;
+  while (i < N) {
+    uint8_t op = dl[i++];
+    if (op == DL_END) break;
+    if (op == DL_COLOR) { gfx::color = (uint16_t)(dl[i] | (dl[i + 1] << 8)); i += 2; continue; }
+    int16_t p[6] = {};
+    uint8_t argc = signArgCount(op);
+    for (uint8_t k = 0; k < argc; k++) p[k] = (int16_t)(dl[i + k * 2] | (dl[i + k * 2 + 1] << 8));
+    i += argc * 2;
+    switch (op) {
+      case SL_CIRCLE: gfx::fillCircle(p[0], p[1], p[2]); break;
+      case SL_RECT:   gfx::fillRect(p[0], p[1], p[2], p[3]); break;
+      case SL_TRI:    gfx::fillTriangle(p[0], p[1], p[2], p[3], p[4], p[5]); break;
+      case SL_STROKE: {
+        bool steep = abs(p[3] - p[1]) > abs(p[2] - p[0]);
+        for (int k = -p[4]; k <= p[4]; k++) {
+          int16_t dx = steep ? k : 0, dy = steep ? 0 : k;
+          gfx::drawLine(p[0] + dx, p[1] + dy, p[2] + dx, p[3] + dy);
+        }
+        break;
+      }
+    }
+  }
+}
+
+// таблица -> tab, как signDrawSpans
+static void drawTable(const SignSpanView& v) {
+  for (auto& row : tab) for (auto& px : row) px = SIGN_BG;
+  uint16_t w0 = 0;
+  for (uint8_t g = 0; g < v.groups; g++) {
+    for (uint16_t i = w0; i < v.end[g]; i++) {
+      const SignWin& w = v.win[i];
+      for (int y = w.y0; y <= w.y1; y++)
+        for (int x = w.x0; x <= w.x1; x++) tab[y][x] = v.color[g];
+    }
+    w0 = v.end[g];
+  }
+}
+
+static int failed = 0;
+
+template<size_t N>
+static void check(const char* name, const SignSpanView& v, const uint8_t (&dl)[N]) {
+  drawRef(dl);
+  drawTable(v);
+  int diff = 0, fx = -1, fy = -1;
+  for (int y = 0; y < SIGN_SCREEN_H; y++)
+    for (int x = 0; x < SIGN_SCREEN_W; x++)
+      if (ref[y][x] != tab[y][x] && diff++ == 0) { fx = x; fy = y; }
+  printf("%-14s %4u windows  %s", name, v.groups ? v.end[v.groups - 1] : 0, diff ? "FAIL" : "ok");
+  if (diff) printf(": %d px differ, first at (%d,%d)", diff, fx, fy);
+  printf("\n");
+  if (diff) failed++;
+}
+
+int main() {
+#define SIGN_CHECK_X(sv, dl) check(#sv, sv, dl);
+  SIGN_BUILTIN_LIST(SIGN_CHECK_X)
+#undef SIGN_CHECK_X
+  return failed ? 1 : 0;
+}
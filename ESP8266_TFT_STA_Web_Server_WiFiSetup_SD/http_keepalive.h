@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+#include "web_server.h"
+
+// ===== HTTP/1.1 keep-alive =====
+// Без keep-alive каждый запрос — новое TCP соединение; на ESP8266
+// рукопожатие и lwIP обходятся дороже самого обработчика.
+// ESP8266WebServer (ядро 3.x) умеет держать соединение: следующий
+// запрос из того же сокета (в том числе уже пришедший конвейером,
+// pipelining) разбирается на следующем handleClient().
+//
+// Пока соединение держится, другие клиенты ждут (сервер обслуживает
+// одного), поэтому здесь же ограничения:
+//   HTTP_IDLE_MS          — закрыть соединение без запросов дольше этого
+//   HTTP_MAX_REQ_PER_CONN — закрыть после стольких запросов
+//
+// /api/http — счётчики соединений и запросов.
+// Лимиты (HTTP_KEEPALIVE, HTTP_IDLE_MS, ...) — в web_server.h.
+// С PANEL_ASYNC_SERVER соединения и лимиты ведёт сам AsyncPanelServer.
+
+#if PANEL_ASYNC_SERVER
+
+static void keepAliveBegin(PanelWebServer& server) {
+  server.keepAlive(HTTP_KEEPALIVE);
+  server.on("/api/http", [&](){ server.send(200, "application/json", server.connStatsJson()); });
+}
+
+static inline void keepAlivePoll(PanelWebServer&) {}
+static inline void keepAliveRelease() {}
+
+#else
+
+struct KaStats {
+  uint32_t conns, reqs, closedIdle, closedCap;
+};
+
+static KaStats   kaStats;
+static IPAddress kaIP;
+static uint16_t  kaPort = 0;
+static uint16_t  kaReqs = 0;         // запросов в текущем соединении
+static uint32_t  kaLastMs = 0;
+static bool      kaOpen = false;
+
+static String keepAliveStatsJson() {
+  String s = "{";
+  s += "\"keepalive\":" + String(HTTP_KEEPALIVE ? "true" : "false");
+  s += ",\"idle_ms\":" + String(HTTP_IDLE_MS);
+  s += ",\"max_req\":" + String(HTTP_MAX_REQ_PER_CONN);
+  s += ",\"conns\":" + String(kaStats.conns);
+  s += ",\"reqs\":" + String(kaStats.reqs);
+  s += ",\"closed_idle\":" + String(kaStats.closedIdle);
+  s += ",\"closed_cap\":" + String(kaStats.closedCap);
+  s += "}";
+  return s;
+}
+
+static void keepAliveBegin(PanelWebServer& server) {
+  server.keepAlive(HTTP_KEEPALIVE);
+
+  // хук видит каждый запрос: новое соединение — другой IP:порт клиента
+  server.addHook([](const String&, const String&, WiFiClient* client, ESP8266WebServer::ContentTypeFunction) {
+    if (!client) return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+    if (!kaOpen || client->remotePort() != kaPort || client->remoteIP() != kaIP) {
+      kaIP = client->remoteIP();
+      kaPort = client->remotePort();
+      kaReqs = 0;
+      kaOpen = true;
+      kaStats.conns++;
+    }
+    kaReqs++;
+    kaStats.reqs++;
+    kaLastMs = millis();
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+  });
+
+  server.on("/api/http", [&](){ server.send(200, "application/json", keepAliveStatsJson()); });
+}
+
+// Соединение текущего запроса забрал другой модуль (поток SSE): не закрывать.
+static inline void keepAliveRelease() { kaOpen = false; }
+
+// В loop() после handleClient: закрыть соединение по лимиту или простою.
+static void keepAlivePoll(PanelWebServer& server) {
+  if (!HTTP_KEEPALIVE || !kaOpen) return;
+
+  WiFiClient& c = server.client();
+  if (!c.connected()) { kaOpen = false; return; }
+
+  if (kaReqs >= HTTP_MAX_REQ_PER_CONN) {
+    kaStats.closedCap++;       // клиент HTTP/1.1 повторит остаток конвейера
+  } else if (!c.available() && millis() - kaLastMs > HTTP_IDLE_MS) {
+    kaStats.closedIdle++;
+  } else {
+    return;
+  }
+  c.stop();
+  kaOpen = false;
+}
+
+#endif
@@ -0,0 +1,93 @@
+import argparse
+import http.client
+import socket
+import time
+
+# Нагрузочный тест веб-сервера панели: запросов в секунду
+#   - close      — новое TCP соединение на каждый запрос (как раньше)
+#   - keepalive  — одно соединение, запрос-ответ по очереди
+#   - pipeline   — одно соединение, по --depth запросов отправляются сразу
+#   python http_load.py --ip 192.168.1.68 --count 200
+# Сервер закрывает соединение по лимиту запросов (HTTP_MAX_REQ_PER_CONN) —
+# тест переподключается и считает это.
+
+def run_close(ip, port, path, count):
+    for _ in range(count):
+        c = http.client.HTTPConnection(ip, port, timeout=5)
+        c.request("GET", path, headers={"Connection": "close"})
+        c.getresponse().read()
+        c.close()
+    return 0
+
+def run_keepalive(ip, port, path, count):
+    c, reconnects = http.client.HTTPConnection(ip, port, timeout=5), 0
+    for _ in range(count):
+        try:
+            c.request("GET", path)
+            c.getresponse().read()
+        except (http.client.HTTPException, ConnectionError):
+            c.close()
+            c = http.client.HTTPConnection(ip, port, timeout=5)
+            reconnects += 1
+            c.request("GET", path)
+            c.getresponse().read()
+    c.close()
+    return reconnects
+
+def read_response(f):
+    status = f.readline()
+    if not status:
+        raise ConnectionError("closed")
+    length = 0
+    while True:
+        line = f.readline()
+        if line in (b"\r\n", b"\n", b""):
+            break
+        k, _, v = line.decode("latin-1").partition(":")
+        if k.strip().lower() == "content-length":
+            length = int(v)
+    f.read(length)
+
+def run_pipeline(ip, port, path, count, depth):
+    req = f"GET {path} HTTP/1.1\r\nHost: {ip}\r\n\r\n".encode()
+    done, reconnects = 0, 0
+    while done < count:
+        s = socket.create_connection((ip, port), timeout=5)
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        f = s.makefile("rb")
+        try:
+            while done < count:
+                n = min(depth, count - done)
+                s.sendall(req * n)
+                for _ in range(n):
+                    read_response(f)
+                    done += 1
+        except (ConnectionError, socket.timeout, OSError):
+            reconnects += 1   # остаток конвейера отправится заново
+        finally:
+            f.close()
+            s.close()
+    return reconnects
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--ip", required=True)
+    ap.add_argument("--port", type=int, default=80)
+    ap.add_argument("--path", default="/api/ping")
+    ap.add_argument("--count", type=int, default=200)
+    ap.add_argument("--depth", type=int, default=4, help="запросов в конвейере")
+    args = ap.parse_args()
+
+    tests = [
+        ("close", lambda: run_close(args.ip, args.port, args.path, args.count)),
+        ("keepalive", lambda: run_keepalive(args.ip, args.port, args.path, args.count)),
+        ("pipeline", lambda: run_pipeline(args.ip, args.port, args.path, args.count, args.depth)),
+    ]
+    for name, fn in tests:
+        t = time.perf_counter()
+        reconnects = fn()
+        dt = time.perf_counter() - t
+        print(f"{name:>10}: {args.count / dt:7.1f} req/s  ({dt * 1000 / args.count:.2f} ms/req, reconnects {reconnects})")
+
+if __name__ == "__main__":
+    main()
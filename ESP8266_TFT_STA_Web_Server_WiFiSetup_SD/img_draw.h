@@ -4,16 +4,27 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7735.h>
 
+#include "metrics.h"
+#include "trace.h"
+#include "sd_test.h"
+#include "sd_reader.h"
+#include "spi_bus.h"
+
 // Должен быть объявлен в твоём .ino
 extern Adafruit_ST7735 tft;
 
-static uint16_t _rd16(File &f) {
+// строк BMP за одну пачку SD -> TFT (буфер 320 байт на строку)
+#ifndef IMG_BATCH_ROWS
+  #define IMG_BATCH_ROWS 8
+#endif
+
+template <class F> static uint16_t _rd16(F &f) {
   uint16_t r;
   ((uint8_t*)&r)[0] = f.read();
   ((uint8_t*)&r)[1] = f.read();
   return r;
 }
-static uint32_t _rd32(File &f) {
+template <class F> static uint32_t _rd32(F &f) {
   uint32_t r;
   ((uint8_t*)&r)[0] = f.read();
   ((uint8_t*)&r)[1] = f.read();
@@ -22,10 +33,23 @@ static uint32_t _rd32(File &f) {
   return r;
 }
 
+// последний нарисованный BMP (для /api/events)
+static char     imgCurFile[64] = "";
+static uint32_t imgGen = 0;
+
 // Рисует BMP по координатам (x,y). Поддержка 24-bit, 16-bit (RGB565) и 1-bit (indexed), без сжатия.
+// Файл читается через SdReader (sd_reader.h): строка — одно read() из
+// кэша, с карты — блоками по SD_READ_CACHE байт.
 static bool drawBmpFromSD(const char* filename, int16_t x, int16_t y) {
-  File bmp = SD.open(filename, FILE_READ);
-  if (!bmp) return false;
+  METRIC_DRAW(MD_BMP);
+  TRACE_SCOPE(TR_BMP);
+  SdReader& bmp = sdReader;
+  TRACE_BEGIN(TR_SD_OPEN);
+  bool opened = bmp.open(filename);
+  TRACE_END(TR_SD_OPEN);
+  if (!opened) { sdIoFailed(); return false; }
+  strncpy(imgCurFile, filename, sizeof(imgCurFile) - 1);
+  imgGen++;
 
   if (_rd16(bmp) != 0x4D42) { bmp.close(); return false; } // 'BM'
   (void)_rd32(bmp); // fileSize
@@ -61,9 +85,6 @@ static bool drawBmpFromSD(const char* filename, int16_t x, int16_t y) {
     bmp.close(); return true;
   }
 
-  // line buffer (экран 160 ширина)
-  static uint16_t line[160];
-
   // Для 1bpp: читаем палитру (2 цвета) если она есть.
   // Палитра начинается сразу после DIB заголовка: offset = 14 + headerSize.
   // Каждый entry: 4 байта (B,G,R,0)
@@ -82,105 +103,72 @@ static bool drawBmpFromSD(const char* filename, int16_t x, int16_t y) {
     }
   }
 
-  tft.startWrite();
-
-  if (depth == 24 || depth == 16) {
-    // row size aligned to 4 bytes
-    uint32_t rowSize = ((depth * (uint32_t)w + 31) / 32) * 4;
-
-    for (int32_t row = 0; row < h; row++) {
-      int32_t bmpRow = flip ? (h - 1 - row) : row;
-      uint32_t pos = dataOff + (uint32_t)bmpRow * rowSize;
-      if (!bmp.seek(pos)) { tft.endWrite(); bmp.close(); return false; }
-
+  // row size aligned to 4 bytes (для 1bpp: (w+7)/8 байт + padding)
+  uint32_t rowSize = ((depth * (uint32_t)w + 31) / 32) * 4;
+
+  // Видимые по X столбцы (рисуем максимум 160 первых пикселей строки)
+  int16_t cols = (w > 160) ? 160 : (int16_t)w;
+  int16_t xx = x, start = 0, drawW = cols;
+  if (xx < 0) { start = -xx; drawW += xx; xx = 0; }
+  if (xx + drawW > (int16_t)tft.width()) drawW = (int16_t)tft.width() - xx;
+  if (drawW <= 0) { bmp.close(); return true; }
+
+  // Нужные байты строки: только видимые cols пикселей.
+  uint32_t rowBytes = depth == 1 ? (cols + 7) / 8 : (uint32_t)cols * (depth / 8);
+
+  // Пачками по IMG_BATCH_ROWS строк: сначала шина у SD (чтение строк),
+  // потом одна транзакция TFT на всю пачку.
+  static uint16_t rows[IMG_BATCH_ROWS][160];
+  static uint8_t  raw[160 * 3];
+  int16_t rowY[IMG_BATCH_ROWS];
+
+  for (int32_t row = 0; row < h; ) {
+    uint8_t n = 0;
+    spiBusClaim(SPI_DEV_SD);
+    for (; row < h && n < IMG_BATCH_ROWS; row++) {
       int16_t yy = y + (int16_t)row;
       if (yy < 0 || yy >= (int16_t)tft.height()) continue;
 
-      int32_t cols = w;
-      if (cols > 160) cols = 160;
+      int32_t bmpRow = flip ? (h - 1 - row) : row;
+      TRACE_BEGIN(TR_SD_SEEK);
+      bool seekOk = bmp.seek(dataOff + (uint32_t)bmpRow * rowSize);
+      TRACE_END(TR_SD_SEEK);
+      if (!seekOk) { bmp.close(); sdIoFailed(); return false; }
+
+      // файл обрезан: недочитанное — 0xFF, как прежний побайтный read() == -1
+      int got = bmp.read(raw, rowBytes);
+      if (got < (int)rowBytes) memset(raw + max(got, 0), 0xFF, rowBytes - max(got, 0));
 
+      uint16_t* line = rows[n];
+      const uint8_t* p = raw;
       if (depth == 24) {
-        for (int32_t col = 0; col < cols; col++) {
-          uint8_t b = bmp.read();
-          uint8_t g = bmp.read();
-          uint8_t r = bmp.read();
-          line[col] = tft.color565(r, g, b);
+        for (int16_t col = 0; col < cols; col++, p += 3) {
+          line[col] = tft.color565(p[2], p[1], p[0]);
         }
-      } else { // 16-bit
-        for (int32_t col = 0; col < cols; col++) {
-          line[col] = _rd16(bmp);
+      } else if (depth == 16) {
+        for (int16_t col = 0; col < cols; col++, p += 2) line[col] = p[0] | (p[1] << 8);
+      } else {
+        // ===== 1 bpp =====
+        int16_t col = 0;
+        while (col < cols) {
+          uint8_t b = *p++;
+          for (int bit = 7; bit >= 0 && col < cols; bit--) {
+            line[col++] = ((b >> bit) & 1) ? pal1 : pal0; // 1->pal1, 0->pal0
+          }
         }
       }
-
-      int16_t xx = x;
-      int16_t start = 0;
-      int16_t drawW = (int16_t)w;
-
-      if (xx < 0) { start = -xx; drawW += xx; xx = 0; }
-      if (xx + drawW > (int16_t)tft.width()) drawW = (int16_t)tft.width() - xx;
-      if (drawW <= 0) continue;
-
-      tft.setAddrWindow(xx, yy, drawW, 1);
-      for (int16_t i = 0; i < drawW; i++) {
-        tft.writePixel(xx + i, yy, line[start + i]);
-      }
+      rowY[n++] = yy;
     }
 
-  } else {
-    // ===== 1 bpp =====
-    // bytes per row (без padding) = (w+7)/8
-    // BMP padding до 4 байт
-    uint32_t rowBytes = ((uint32_t)w + 7) / 8;
-    uint32_t rowSize  = (rowBytes + 3) & ~3UL;
-
-    // буфер под строку (для 160px достаточно 20 байт + padding)
-    static uint8_t rowBuf[24];
-
-    for (int32_t row = 0; row < h; row++) {
-      int32_t bmpRow = flip ? (h - 1 - row) : row;
-      uint32_t pos = dataOff + (uint32_t)bmpRow * rowSize;
-      if (!bmp.seek(pos)) { tft.endWrite(); bmp.close(); return false; }
-
-      int16_t yy = y + (int16_t)row;
-      if (yy < 0 || yy >= (int16_t)tft.height()) continue;
-
-      // ограничим w под 160, но читать строку всё равно нужно правильно.
-      // Если w > 160, мы просто рисуем первые 160 пикселей.
-      uint16_t drawCols = (w > 160) ? 160 : (uint16_t)w;
-
-      // читаем минимум нужных байт строки, но не больше буфера
-      uint32_t needBytes = ((uint32_t)drawCols + 7) / 8;
-      if (needBytes > sizeof(rowBuf)) needBytes = sizeof(rowBuf);
-
-      // читаем байты строки
-      for (uint32_t i = 0; i < needBytes; i++) rowBuf[i] = (uint8_t)bmp.read();
-
-      // преобразуем в line[]
-      uint16_t col = 0;
-      for (uint32_t bi = 0; bi < needBytes && col < drawCols; bi++) {
-        uint8_t b = rowBuf[bi];
-        for (int bit = 7; bit >= 0 && col < drawCols; bit--) {
-          bool on = (b >> bit) & 1;
-          line[col++] = on ? pal1 : pal0; // 1->pal1, 0->pal0
-        }
-      }
-
-      int16_t xx = x;
-      int16_t start = 0;
-      int16_t drawW = (int16_t)drawCols;
-
-      if (xx < 0) { start = -xx; drawW += xx; xx = 0; }
-      if (xx + drawW > (int16_t)tft.width()) drawW = (int16_t)tft.width() - xx;
-      if (drawW <= 0) continue;
-
-      tft.setAddrWindow(xx, yy, drawW, 1);
-      for (int16_t i = 0; i < drawW; i++) {
-        tft.writePixel(xx + i, yy, line[start + i]);
-      }
+    if (!n) continue;
+    spiTftBegin();
+    for (uint8_t i = 0; i < n; i++) {
+      tft.setAddrWindow(xx, rowY[i], drawW, 1);
+      tft.writePixels(rows[i] + start, drawW);
     }
+    spiTftEnd();
   }
 
-  tft.endWrite();
   bmp.close();
   return true;
 }
@@ -0,0 +1,61 @@
+import argparse
+import struct
+
+# Текстовое описание знака -> display list (.sgn) для /signs на SD.
+# Формат совпадает с sign_model.h:
+#   color #RRGGBB
+#   circle x y r
+#   rect   x y w h
+#   tri    x0 y0 x1 y1 x2 y2
+#   stroke x0 y0 x1 y1 half
+# Пустые строки и строки с '#' в начале пропускаются.
+
+DL_END = 0x00
+DL_COLOR = 0x80
+OPS = {
+    "circle": (0x01, 3),
+    "rect":   (0x02, 4),
+    "tri":    (0x03, 6),
+    "stroke": (0x04, 5),
+}
+
+def rgb565(hexstr: str) -> int:
+    h = hexstr.lstrip("#")
+    r, g, b = int(h[0:2], 16), int(h[2:4], 16), int(h[4:6], 16)
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+def build(src: str, out: str):
+    data = bytearray()
+    layers = 0
+    with open(src, encoding="utf-8") as f:
+        for n, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            parts = line.split()
+            cmd, args = parts[0].lower(), parts[1:]
+            if cmd == "color":
+                data += bytes([DL_COLOR]) + struct.pack("<H", rgb565(args[0]))
+                continue
+            if cmd not in OPS:
+                raise SystemExit(f"{src}:{n}: unknown command '{cmd}'")
+            op, argc = OPS[cmd]
+            if len(args) != argc:
+                raise SystemExit(f"{src}:{n}: '{cmd}' needs {argc} numbers")
+            data += bytes([op]) + struct.pack("<%dh" % argc, *[int(a) for a in args])
+            layers += 1
+    data.append(DL_END)
+    if len(data) > 512:
+        raise SystemExit(f"{src}: {len(data)} bytes, limit is 512 (SIGN_MAX_DL)")
+    if layers > 16:
+        raise SystemExit(f"{src}: {layers} layers, limit is 16 (SIGN_MAX_LAYERS)")
+    with open(out, "wb") as f:
+        f.write(data)
+    print("Saved:", out, "| layers=", layers, "bytes=", len(data))
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--src", required=True)
+    ap.add_argument("--out", required=True)
+    args = ap.parse_args()
+    build(args.src, args.out)
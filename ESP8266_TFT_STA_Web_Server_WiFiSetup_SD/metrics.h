@@ -0,0 +1,177 @@
+#pragma once
+#include <Arduino.h>
+#include "web_server.h"
+#include "boot_profile.h"
+
+// ===== Метрики (/metrics, формат Prometheus) =====
+// Гистограммы с фиксированными корзинами:
+//   panel_http_request_duration_seconds{path=...} — каждый server.on
+//     (хук ESP8266WebServer + замер вокруг handleClient, маршруты не трогаем)
+//   panel_draw_duration_seconds{op=...}           — пути отрисовки
+// и состояние кучи: свободно, крупнейший блок, фрагментация, минимум.
+//
+// METRICS_ENABLED 0 — макросы пустые, маршрута /metrics нет, хук не ставится.
+
+#ifndef METRICS_ENABLED
+  #define METRICS_ENABLED 1
+#endif
+#ifndef METRICS_ROUTES
+  #define METRICS_ROUTES 24       // разных путей; остальные — path="other"
+#endif
+
+#if METRICS_ENABLED
+
+// верхние границы корзин, мкс (последняя — +Inf)
+static const uint32_t M_BUCKET_US[] = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000 };
+static const char* const M_BUCKET_LE[] = { "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1", "+Inf" };
+#define M_BUCKETS (sizeof(M_BUCKET_US) / sizeof(M_BUCKET_US[0]) + 1)
+
+struct MHist {
+  uint32_t n[M_BUCKETS];    // не накопительно; накопление — при выводе
+  uint32_t count;
+  uint64_t sumUs;
+};
+
+enum MDraw : uint8_t {
+  MD_BMP = 0,     // drawBmpFromSD
+  MD_SIGN,        // signShow (встроенный знак)
+  MD_SIGN_SD,     // signShowFromSD
+  MD_COUNT
+};
+static const char* const MD_NAMES[MD_COUNT] = { "bmp", "sign", "sign_sd" };
+
+struct MRoute {
+  char  path[24];
+  MHist h;
+};
+
+static MHist    mDraw[MD_COUNT];
+static MRoute   mRoutes[METRICS_ROUTES];
+static uint8_t  mRouteN = 0;
+static MHist    mOther;
+
+static bool     mReqOpen = false;
+static uint32_t mReqStart = 0;
+static MHist*   mReqHist = nullptr;
+static uint32_t mHeapMin = 0xFFFFFFFF;
+
+static inline void mObserve(MHist& h, uint32_t us) {
+  uint8_t b = 0;
+  while (b < M_BUCKETS - 1 && us > M_BUCKET_US[b]) b++;
+  h.n[b]++;
+  h.count++;
+  h.sumUs += us;
+}
+
+static inline void mSampleHeap() {
+  uint32_t f = ESP.getFreeHeap();
+  if (f < mHeapMin) mHeapMin = f;
+}
+
+// Замер до конца области видимости (несколько return в функции — не помеха).
+class MetricScope {
+public:
+  explicit MetricScope(MHist& h) : _h(h), _t0(micros()) {}
+  ~MetricScope() { mObserve(_h, micros() - _t0); mSampleHeap(); }
+private:
+  MHist&   _h;
+  uint32_t _t0;
+};
+
+#define METRIC_DRAW(id) MetricScope _metricScope(mDraw[id])
+
+// Слот — только маршрутам server.on (web_server.h), прочее — "other".
+static MHist* mRouteHist(const String& url) {
+  if (!panelRouteKnown(url)) return &mOther;
+  int q = url.indexOf('?');
+  String path = q < 0 ? url : url.substring(0, q);
+  for (uint8_t i = 0; i < mRouteN; i++) {
+    if (path == mRoutes[i].path) return &mRoutes[i].h;
+  }
+  if (mRouteN >= METRICS_ROUTES || path.length() >= sizeof(mRoutes[0].path)) return &mOther;
+  MRoute& r = mRoutes[mRouteN++];
+  strncpy(r.path, path.c_str(), sizeof(r.path) - 1);
+  return &r.h;
+}
+
+// Значение метки по правилам Prometheus: \\, \" и \n.
+static String mEscLabel(const char* v) {
+  String s;
+  for (; *v; v++) {
+    if (*v == '\\' || *v == '"') { s += '\\'; s += *v; }
+    else if (*v == '\n') s += "\\n";
+    else s += *v;
+  }
+  return s;
+}
+
+static void mSendHist(PanelWebServer& server, const char* name, const char* label, const char* value, const MHist& h) {
+  String lbl = String(label) + "=\"" + mEscLabel(value) + "\"";
+  String s;
+  uint32_t acc = 0;
+  for (uint8_t b = 0; b < M_BUCKETS; b++) {
+    acc += h.n[b];
+    s += String(name) + "_bucket{" + lbl + ",le=\"" + M_BUCKET_LE[b] + "\"} " + String(acc) + "\n";
+  }
+  s += String(name) + "_sum{" + lbl + "} " + String((double)h.sumUs / 1e6, 6) + "\n";
+  s += String(name) + "_count{" + lbl + "} " + String(h.count) + "\n";
+  server.sendContent(s);
+}
+
+static void mHandleMetrics(PanelWebServer& server) {
+  mSampleHeap();
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4", "");
+
+  server.sendContent("# TYPE panel_http_request_duration_seconds histogram\n");
+  for (uint8_t i = 0; i < mRouteN; i++) {
+    mSendHist(server, "panel_http_request_duration_seconds", "path", mRoutes[i].path, mRoutes[i].h);
+  }
+  mSendHist(server, "panel_http_request_duration_seconds", "path", "other", mOther);
+
+  server.sendContent("# TYPE panel_draw_duration_seconds histogram\n");
+  for (uint8_t i = 0; i < MD_COUNT; i++) {
+    mSendHist(server, "panel_draw_duration_seconds", "op", MD_NAMES[i], mDraw[i]);
+  }
+
+  String s;
+  s += "# TYPE panel_heap_free_bytes gauge\npanel_heap_free_bytes " + String(ESP.getFreeHeap()) + "\n";
+  s += "# TYPE panel_heap_free_min_bytes gauge\npanel_heap_free_min_bytes " + String(mHeapMin) + "\n";
+  s += "# TYPE panel_heap_max_block_bytes gauge\npanel_heap_max_block_bytes " + String(ESP.getMaxFreeBlockSize()) + "\n";
+  s += "# TYPE panel_heap_fragmentation_percent gauge\npanel_heap_fragmentation_percent " + String(ESP.getHeapFragmentation()) + "\n";
+  s += "# TYPE panel_uptime_seconds counter\npanel_uptime_seconds " + String(millis() / 1000) + "\n";
+  server.sendContent(s);
+  server.sendContent(bootMetricsText());
+  server.sendContent("");
+}
+
+static void metricsBegin(PanelWebServer& server) {
+  // хук зовётся после разбора строки запроса, прямо перед обработчиком
+  server.addHook([](const String&, const String& url, WiFiClient*, ESP8266WebServer::ContentTypeFunction) {
+    mReqHist = mRouteHist(url);
+    mReqStart = micros();
+    mReqOpen = true;
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+  });
+  server.on("/metrics", [&](){ mHandleMetrics(server); });
+}
+
+// Вместо server.handleClient() в loop(): запрос обрабатывается целиком
+// внутри одного вызова, поэтому время — от хука до возврата.
+static inline void metricsHandleClient(PanelWebServer& server) {
+  server.handleClient();
+  if (mReqOpen) {
+    mReqOpen = false;
+    mObserve(*mReqHist, micros() - mReqStart);
+    mSampleHeap();
+  }
+}
+
+#else
+
+#define METRIC_DRAW(id) do {} while (0)
+
+static inline void metricsBegin(PanelWebServer&) {}
+static inline void metricsHandleClient(PanelWebServer& server) { server.handleClient(); }
+
+#endif
@@ -0,0 +1,118 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>   // INITR_*
+
+#include "web_server.h"
+#include "config_log.h"
+
+// ===== Настройки панели =====
+// Экран и папки на SD — в журнале настроек (config_log.h), со значениями
+// по умолчанию, если записи нет.
+//
+// GET  /api/config                   -> {"display":{...},"sd":{...},"log":{...}}
+// POST /api/config?rotation=1&spi=0&signs=/signs&start=/roadsigns
+//   любые из полей; пишется только изменившаяся запись.
+//   rotation, tab и spi (МГц TFT, 0 — самотест) применяются после
+//   перезагрузки, папки — сразу.
+//   rotation — только 1 или 3 (альбомная 160x128): таблицы окон знаков
+//   (sign_spans.h) и холсты посчитаны под этот экран.
+
+#define PANEL_DISPLAY_VER 1
+#define PANEL_SD_VER      1
+
+struct PanelDisplayCfg {
+  uint8_t rotation;          // 1 или 3, setRotation()
+  uint8_t tab;               // INITR_BLACKTAB / GREENTAB / REDTAB
+  uint8_t spiMHz;            // частота TFT; 0 — самотест (spi_bus.h)
+  uint8_t reserved;
+};
+
+struct PanelSdCfg {
+  char signsDir[32];         // знаки <signsDir>/<name>.sgn
+  char startDir[32];         // папка, которую открывает /files
+};
+
+static PanelDisplayCfg panelDisplay = { 1, INITR_BLACKTAB, 0, 0 };
+static PanelSdCfg      panelSd = { "/signs", "/" };
+
+// Альбомная ориентация: экран 160x128, как в sign_spans.h.
+static inline bool panelRotationOk(long r) { return r == 1 || r == 3; }
+
+// Папка: "/" и дальше буквы, цифры, _ - / . без "..", без '/' в конце.
+static bool panelDirOk(const String& d) {
+  if (!d.startsWith("/") || d.length() >= sizeof(PanelSdCfg::signsDir)) return false;
+  if (d.indexOf("..") >= 0 || (d.length() > 1 && d.endsWith("/"))) return false;
+  for (unsigned i = 0; i < d.length(); i++) {
+    char c = d[i];
+    if (!isalnum((unsigned char)c) && c != '_' && c != '-' && c != '/' && c != '.') return false;
+  }
+  return true;
+}
+
+// Из setup() после cfgLogBegin(), до инициализации TFT.
+static void panelConfigLoad() {
+  PanelDisplayCfg d;
+  if (cfgRead(CFG_DISPLAY, PANEL_DISPLAY_VER, &d, sizeof(d)) && panelRotationOk(d.rotation) && d.spiMHz <= 40) {
+    panelDisplay = d;
+  }
+  PanelSdCfg s;
+  if (cfgRead(CFG_SD_PATHS, PANEL_SD_VER, &s, sizeof(s))) {
+    s.signsDir[sizeof(s.signsDir) - 1] = 0;
+    s.startDir[sizeof(s.startDir) - 1] = 0;
+    if (panelDirOk(s.signsDir) && panelDirOk(s.startDir)) panelSd = s;
+  }
+}
+
+static String panelConfigJson() {
+  String s = "{\"display\":{\"rotation\":" + String(panelDisplay.rotation);
+  s += ",\"tab\":" + String(panelDisplay.tab);
+  s += ",\"spi\":" + String(panelDisplay.spiMHz) + "}";
+  s += ",\"sd\":{\"signs\":\"" + String(panelSd.signsDir) + "\",\"start\":\"" + String(panelSd.startDir) + "\"}";
+  s += ",\"log\":" + cfgLogStatsJson() + "}";
+  return s;
+}
+
+static void panelConfigRoutes(PanelWebServer& server) {
+  server.on("/api/config", HTTP_GET, [&](){
+    server.send(200, "application/json", panelConfigJson());
+  });
+
+  server.on("/api/config", HTTP_POST, [&](){
+    PanelDisplayCfg d = panelDisplay;
+    PanelSdCfg s = panelSd;
+
+    if (server.hasArg("rotation")) {
+      long v = server.arg("rotation").toInt();
+      if (!panelRotationOk(v)) { server.send(400, "text/plain", "Bad rotation (1 or 3)"); return; }
+      d.rotation = v;
+    }
+    if (server.hasArg("tab")) {
+      long v = server.arg("tab").toInt();
+      if (v != INITR_BLACKTAB && v != INITR_GREENTAB && v != INITR_REDTAB) { server.send(400, "text/plain", "Bad tab"); return; }
+      d.tab = v;
+    }
+    if (server.hasArg("spi")) {
+      long v = server.arg("spi").toInt();
+      if (v < 0 || v > 40) { server.send(400, "text/plain", "Bad spi"); return; }
+      d.spiMHz = v;
+    }
+    if (server.hasArg("signs")) {
+      if (!panelDirOk(server.arg("signs"))) { server.send(400, "text/plain", "Bad signs"); return; }
+      memset(s.signsDir, 0, sizeof(s.signsDir));
+      strncpy(s.signsDir, server.arg("signs").c_str(), sizeof(s.signsDir) - 1);
+    }
+    if (server.hasArg("start")) {
+      if (!panelDirOk(server.arg("start"))) { server.send(400, "text/plain", "Bad start"); return; }
+      memset(s.startDir, 0, sizeof(s.startDir));
+      strncpy(s.startDir, server.arg("start").c_str(), sizeof(s.startDir) - 1);
+    }
+
+    // каждая запись отдельно; в RAM — только то, что легло в журнал,
+    // иначе работающие настройки разойдутся с сохранёнными
+    bool okD = cfgWrite(CFG_DISPLAY, PANEL_DISPLAY_VER, &d, sizeof(d));
+    bool okS = cfgWrite(CFG_SD_PATHS, PANEL_SD_VER, &s, sizeof(s));
+    if (okD) panelDisplay = d;
+    if (okS) panelSd = s;
+    server.send(okD && okS ? 200 : 500, "application/json", panelConfigJson());
+  });
+}
@@ -1,11 +1,13 @@
 #pragma once
 #include <SD.h>
-#include <ESP8266WebServer.h>
+#include "web_server.h"
 
 #include "img_draw.h"
+#include "sign_model.h"
+#include "sd_test.h"
 
 // объявлен в .ino
-extern ESP8266WebServer server;
+extern PanelWebServer server;
 
 // ----------------- utils -----------------
 static bool sd_isSafePath(const String& p) {
@@ -28,6 +30,19 @@ static String sd_guessMime(const String& path) {
   return "application/octet-stream";
 }
 
+// Карта смонтирована (или смонтировалась сейчас); иначе 503.
+static bool sd_need() {
+  if (sdEnsure()) return true;
+  server.send(503, "text/plain", "No SD card");
+  return false;
+}
+
+// Файл или папка не открылись: 404, если карта на месте, иначе 503.
+static void sd_sendMissing(const char* msg) {
+  if (sdIoFailed()) server.send(404, "text/plain", msg);
+  else server.send(503, "text/plain", "No SD card");
+}
+
 // ----------------- API: list dir -----------------
 // GET /api/list?dir=/roadsigns
 // returns: [{"name":"/roadsigns/a.bmp","dir":false,"size":1234}, ...]
@@ -35,9 +50,11 @@ static void sd_handleApiList() {
   String dir = server.arg("dir");
   if (dir == "") dir = "/";
   if (!sd_isSafePath(dir)) { server.send(400, "text/plain", "Bad dir"); return; }
+  if (!sd_need()) return;
 
   File d = SD.open(dir);
-  if (!d || !d.isDirectory()) { server.send(404, "text/plain", "No dir"); return; }
+  if (!d) { sd_sendMissing("No dir"); return; }
+  if (!d.isDirectory()) { server.send(404, "text/plain", "No dir"); return; }
 
   String out = "[";
   bool first = true;
@@ -73,13 +90,19 @@ static void sd_handleGetFile() {
   String path = server.arg("path");
   if (path == "") { server.send(400, "text/plain", "Missing path"); return; }
   if (!sd_isSafePath(path)) { server.send(400, "text/plain", "Bad path"); return; }
-  if (!SD.exists(path)) { server.send(404, "text/plain", "Not found"); return; }
+  if (!sd_need()) return;
+  if (!SD.exists(path)) { sd_sendMissing("Not found"); return; }
 
+#if PANEL_ASYNC_SERVER
+  // async: файл отдаётся по мере окна TCP своим насосом streamFile
   File f = SD.open(path, FILE_READ);
   if (!f) { server.send(500, "text/plain", "Open error"); return; }
 
   server.streamFile(f, sd_guessMime(path));
   f.close();
+#else
+  sdStreamFile(server, path, sd_guessMime(path));   // ошибки отвечает сам
+#endif
 }
 
 // ----------------- API: show on TFT -----------------
@@ -88,13 +111,15 @@ static void sd_handleGetFile() {
 static void sd_handleApiShow() {
   String file = server.arg("file");
   if (!sd_isSafePath(file)) { server.send(400, "text/plain", "Bad file"); return; }
-  if (!SD.exists(file))  { server.send(404, "text/plain", "Not found"); return; }
+  if (!sd_need()) return;
+  if (!SD.exists(file))  { sd_sendMissing("Not found"); return; }
 
   int16_t x = 16, y = 0;            // центр 128x128 на 160x128
   if (server.arg("full") == "1") {  // если файл 160x128
     x = 0; y = 0;
   }
 
+  signInvalidate();   // экран больше не содержит знак
   bool ok = drawBmpFromSD(file.c_str(), x, y);
   server.send(ok ? 200 : 500, "text/plain", ok ? "OK" : "DRAW_ERR");
 }
@@ -122,7 +147,7 @@ static void sd_handleFilesPage() {
     "<p id='cur'></p>"
     "<div id='list'></div>"
     "<script>"
-    "var cur='/';"
+    "var cur='" + String(panelSd.startDir) + "';"   // panelDirOk: без кавычек
 
     "function escHtml(s){"
     "  return String(s).replace(/&/g,'&amp;').replace(/</g,'&lt;').replace(/>/g,'&gt;')"
@@ -172,4 +197,7 @@ static void registerSdBrowserRoutes() {
 
   // File streaming
   server.on("/sd", HTTP_GET, sd_handleGetFile);
+
+  // Скорость чтения SD
+  sdBenchRoutes(server);
 }
@@ -0,0 +1,269 @@
+#pragma once
+#include <Arduino.h>
+#include <SD.h>
+
+#include "web_server.h"
+#include "sd_test.h"
+#include "trace.h"
+
+// ===== Чтение файлов с SD крупными блоками =====
+// SdReader — чтение файла через кэш SD_READ_CACHE байт, выровненный
+// по секторам 512 байт: мелкие read()/seek() (строки BMP, заголовки)
+// обслуживаются из RAM, промах — одно чтение на весь кэш.
+// Чтения не меньше кэша идут мимо него, прямо в буфер вызывающего.
+//
+// SD_BACKEND_SDFAT 1 — файл открывается напрямую в SdFat (своя копия
+// тома на той же карте, только чтение). Если файл лежит на карте
+// одним куском (contiguousRange), блоки читаются прямо с карты
+// card()->readSectors: несколько секторов одной командой CMD18, без
+// FAT и без копии через кэш библиотеки.
+// SD_BACKEND_SDFAT 0 — тот же кэш поверх File библиотеки SD.
+//
+// GET /api/sdbench?path=/roadsigns/a.bmp&mode=seq|row&backend=file|reader&row=480
+//   seq — файл целиком кусками SD_READ_CACHE; row — строки по row байт
+//   снизу вверх (как BMP). file — File библиотеки SD, reader — SdReader.
+//   -> {"kbps":...,"ms":...,"bytes":...,"multiblock":...,"stream_errors":...}
+//   stream_errors — отдач файла (sdStreamFile), оборванных ошибкой чтения.
+
+#ifndef SD_BACKEND_SDFAT
+  #define SD_BACKEND_SDFAT 1
+#endif
+#ifndef SD_READ_CACHE
+  #define SD_READ_CACHE 2048      // кратно 512
+#endif
+static_assert(SD_READ_CACHE % 512 == 0 && SD_READ_CACHE >= 512, "SD_READ_CACHE must be a multiple of 512");
+
+#if SD_BACKEND_SDFAT
+  #include <SdFat.h>
+
+static sdfat::SdFat sdFat;
+static uint32_t     sdFatGen = 0;     // sdGen, при котором смонтирован том
+
+// Том SdFat — после каждого монтирования SD (карту могли заменить).
+static bool sdFatEnsure() {
+  if (!sdEnsure()) return false;
+  if (sdFatGen == sdGen) return true;
+  if (!sdFat.begin(sdfat::SdSpiConfig(SD_CS, SHARED_SPI, SD_SPI_HZ))) {
+    Serial.println("SdFat mount FAILED");
+    return false;
+  }
+  sdFatGen = sdGen;
+  return true;
+}
+#endif
+
+// счётчики для /api/sdbench
+static uint32_t sdrMultiReads = 0;    // чтений по несколько секторов с карты
+static uint32_t sdrSectors = 0;
+static uint32_t sdrStreamErrors = 0;  // отдач файла, оборванных ошибкой чтения
+
+class SdReader {
+public:
+  bool open(const char* path) {
+    close();
+#if SD_BACKEND_SDFAT
+    if (!sdFatEnsure()) return false;
+    _f = sdFat.open(path, O_RDONLY);
+    if (!_f) return false;
+    _size = _f.fileSize();
+    uint32_t last;
+    _contig = _f.contiguousRange(&_first, &last);
+#else
+    if (!sdEnsure()) return false;
+    _f = SD.open(path, FILE_READ);
+    if (!_f) return false;
+    _size = _f.size();
+#endif
+    _pos = 0;
+    _bufPos = _bufLen = 0;
+    return true;
+  }
+
+  void close() {
+    if (_f) _f.close();
+    _contig = false;
+  }
+
+  explicit operator bool() const { return (bool)_f; }
+  uint32_t size() const       { return _size; }
+  uint32_t position() const   { return _pos; }
+  uint32_t available() const  { return _size - _pos; }
+  bool     contiguous() const { return _contig; }
+
+  bool seek(uint32_t pos) {
+    if (pos > _size) return false;
+    _pos = pos;
+    return true;
+  }
+
+  int read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+
+  int read(uint8_t* dst, size_t n) {
+    n = min<size_t>(n, _size - _pos);
+    size_t done = 0;
+    while (done < n) {
+      // в кэше
+      if (_pos >= _bufPos && _pos < _bufPos + _bufLen) {
+        size_t k = min<size_t>(n - done, _bufPos + _bufLen - _pos);
+        memcpy(dst + done, _buf + (_pos - _bufPos), k);
+        done += k;
+        _pos += k;
+        continue;
+      }
+      // крупный выровненный кусок — прямо в dst
+      size_t rest = n - done;
+      if (_pos % 512 == 0 && rest >= SD_READ_CACHE) {
+        size_t k = rest & ~(size_t)511;
+        if (!raw(_pos, dst + done, k)) break;
+        done += k;
+        _pos += k;
+        continue;
+      }
+      // промах: окно кэша; при чтении назад (BMP снизу вверх) —
+      // окно заканчивается на текущем куске, предыдущие строки попадут в него
+      uint32_t from = _pos & ~511u;
+      if (_bufLen && _pos < _bufPos) {
+        uint32_t end = (_pos + rest + 511) & ~511u;
+        from = min<uint32_t>(from, end > SD_READ_CACHE ? end - SD_READ_CACHE : 0);
+      }
+      size_t len = min<size_t>(SD_READ_CACHE, _size - from);
+      if (!raw(from, _buf, len)) break;
+      _bufPos = from;
+      _bufLen = len;
+    }
+    return (int)done;
+  }
+
+private:
+  // n байт с позиции off (off кратно 512). В кэш можно читать
+  // целыми секторами и за концом файла — место есть.
+  bool raw(uint32_t off, uint8_t* dst, size_t n) {
+    TRACE_BEGIN(TR_SD_READ);
+    bool ok;
+#if SD_BACKEND_SDFAT
+    if (_contig && (n % 512 == 0 || dst == _buf)) {
+      size_t ns = (n + 511) / 512;
+      ok = sdFat.card()->readSectors(_first + off / 512, dst, ns);
+      if (ns > 1) sdrMultiReads++;
+      sdrSectors += ns;
+    } else {
+      ok = _f.seekSet(off) && _f.read(dst, n) == (int)n;
+    }
+#else
+    ok = _f.seek(off) && _f.read(dst, n) == (int)n;
+#endif
+    TRACE_END_ARG(TR_SD_READ, n);
+    if (!ok) { _bufLen = 0; sdIoFailed(); }
+    return ok;
+  }
+
+#if SD_BACKEND_SDFAT
+  sdfat::FsFile _f;
+  uint32_t      _first = 0;        // первый сектор файла, если он одним куском
+#else
+  File          _f;
+#endif
+  bool     _contig = false;
+  uint32_t _size = 0, _pos = 0;
+  uint32_t _bufPos = 0, _bufLen = 0;
+  uint8_t  _buf[SD_READ_CACHE] __attribute__((aligned(4)));
+};
+
+// Один читатель на всех: BMP, отдача файлов и бенчмарк идут из loop()
+// по очереди. sdrChunk — буфер кусков для отдачи файла и бенчмарка.
+static SdReader sdReader;
+static uint8_t  sdrChunk[SD_READ_CACHE];
+
+#if !PANEL_ASYNC_SERVER
+// Отдать файл с SD (ESP8266WebServer): куски SD_READ_CACHE байт
+// читаются мимо кэша, многосекторными чтениями.
+// false — файл не открылся (ушёл 500) или чтение оборвалось: Content-Length
+// уже отправлен, поэтому соединение закрывается — клиент увидит обрыв.
+static bool sdStreamFile(PanelWebServer& server, const String& path, const String& mime) {
+  SdReader& rd = sdReader;
+  if (!rd.open(path.c_str())) { server.send(500, "text/plain", "Open error"); return false; }
+  server.setContentLength(rd.size());
+  server.send(200, mime, "");
+  while (rd.available()) {
+    int n = rd.read(sdrChunk, sizeof(sdrChunk));
+    if (n <= 0) break;
+    server.sendContent((const char*)sdrChunk, n);
+  }
+  bool ok = !rd.available();
+  rd.close();
+  if (!ok) {
+    sdrStreamErrors++;
+    server.client().stop();
+  }
+  return ok;
+}
+#endif
+
+// ---- бенчмарк ----
+
+static String sdBenchRun(const String& path, bool seq, bool useReader, uint32_t rowBytes) {
+  uint8_t* buf = sdrChunk;
+  SdReader& rd = sdReader;
+  rowBytes = constrain<uint32_t>(rowBytes, 1, sizeof(sdrChunk));
+
+  File f;
+  uint32_t size;
+  if (useReader) {
+    if (!rd.open(path.c_str())) return String();
+    size = rd.size();
+  } else {
+    if (!sdEnsure()) return String();
+    f = SD.open(path, FILE_READ);
+    if (!f) return String();
+    size = f.size();
+  }
+
+  uint32_t multi0 = sdrMultiReads;
+  uint32_t bytes = 0;
+  uint32_t t0 = micros();
+  if (seq) {
+    for (;;) {
+      int n = useReader ? rd.read(buf, sizeof(sdrChunk)) : f.read(buf, sizeof(sdrChunk));
+      if (n <= 0) break;
+      bytes += n;
+    }
+  } else {
+    for (int32_t row = size / rowBytes - 1; row >= 0; row--) {
+      uint32_t pos = (uint32_t)row * rowBytes;
+      int n = useReader ? (rd.seek(pos) ? rd.read(buf, rowBytes) : -1)
+                        : (f.seek(pos) ? f.read(buf, rowBytes) : -1);
+      if (n <= 0) break;
+      bytes += n;
+      yield();
+    }
+  }
+  uint32_t us = max<uint32_t>(micros() - t0, 1);
+  bool contig = useReader && rd.contiguous();
+  if (useReader) rd.close(); else f.close();
+
+  String s = "{\"path\":\"" + path + "\",\"size\":" + String(size);
+  s += ",\"mode\":\"" + String(seq ? "seq" : "row") + "\"";
+  s += ",\"backend\":\"" + String(useReader ? (SD_BACKEND_SDFAT ? "sdfat" : "cache") : "file") + "\"";
+  s += ",\"contiguous\":" + String(contig ? "true" : "false");
+  s += ",\"bytes\":" + String(bytes) + ",\"ms\":" + String(us / 1000.0, 1);
+  s += ",\"kbps\":" + String(bytes * 1000.0 / us, 1);   // байт/мс = КБ/с
+  s += ",\"multiblock\":" + String(sdrMultiReads - multi0);
+  s += ",\"stream_errors\":" + String(sdrStreamErrors) + "}";
+  return s;
+}
+
+static void sdBenchRoutes(PanelWebServer& server) {
+  server.on("/api/sdbench", HTTP_GET, [&](){
+    String path = server.arg("path");
+    if (!path.startsWith("/") || path.indexOf("..") >= 0) { server.send(400, "text/plain", "Bad path"); return; }
+    bool seq = server.arg("mode") != "row";
+    bool useReader = server.arg("backend") != "file";
+    uint32_t row = server.hasArg("row") ? server.arg("row").toInt() : 480;
+    String json = sdBenchRun(path, seq, useReader, row);
+    if (!json.length()) { server.send(404, "text/plain", "Open error"); return; }
+    server.send(200, "application/json", json);
+  });
+}
@@ -1,46 +1,57 @@
 #pragma once
 #include <SPI.h>
 #include <SD.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_ST7735.h>
+
+#include "spi_bus.h"
+
+// ===== SD карта: монтирование по требованию =====
+// При загрузке карта не трогается: sdBegin() только поднимает CS.
+// Первое обращение (sdEnsure()) монтирует её; не вышло — следующая
+// попытка через SD_RETRY_MIN_MS, потом вдвое дольше, до SD_RETRY_MAX_MS.
+// Загрузка не ждёт SD, карту можно вставить позже.
+//
+// Карту вынули:
+//  - SD_CD_PIN (контакт card-detect слота) — замечается в sdPoll();
+//  - без него — по ошибке чтения: sdIoFailed() проверяет корень.
+// Тогда SD.end(), SD_ready = false, следующее обращение монтирует заново.
+// sdGen растёт при каждом монтировании — по нему сбрасываются кэши,
+// построенные по содержимому карты.
 
 #ifndef SD_CS
   #define SD_CS D8   // CS для SD (рекомендуется D8/GPIO15)
 #endif
+#ifndef SD_CD_PIN
+  #define SD_CD_PIN -1        // -1 — контакта card-detect нет
+#endif
+#ifndef SD_CD_ACTIVE
+  #define SD_CD_ACTIVE LOW    // уровень "карта вставлена"
+#endif
+#ifndef SD_RETRY_MIN_MS
+  #define SD_RETRY_MIN_MS 1000
+#endif
+#ifndef SD_RETRY_MAX_MS
+  #define SD_RETRY_MAX_MS 30000
+#endif
 
-static bool SD_ready = false;
+static bool     SD_ready = false;
+static uint32_t sdGen = 0;            // номер монтирования
+static uint32_t sdRetryMs = 0;        // следующая попытка не раньше
+static uint32_t sdBackoffMs = 0;      // 0 — пробовать сразу
+static bool     sdListRoot = false;   // листинг корня при первом монтировании
 
-static inline void sd_showStatus(Adafruit_ST7735 &tft, bool ok) {
-  tft.fillScreen(ok ? ST77XX_BLACK : ST77XX_BLACK);
-  tft.setTextSize(2);
-  tft.setTextWrap(false);
-  tft.setCursor(10, 20);
-  tft.setTextColor(ok ? ST77XX_GREEN : ST77XX_RED, ST77XX_BLACK);
-  tft.println(ok ? "SD OK" : "SD FAIL");
+static inline bool sdCardPresent() {
+#if SD_CD_PIN >= 0
+  return digitalRead(SD_CD_PIN) == SD_CD_ACTIVE;
+#else
+  return true;
+#endif
 }
 
-static inline bool SD_init(Adafruit_ST7735 &tft) {
-  pinMode(SD_CS, OUTPUT);
-  digitalWrite(SD_CS, HIGH);   // SD не выбрана
-
-  Serial.println("\nSD init...");
-
-  if (!SD.begin(SD_CS)) {
-    Serial.println("SD init FAILED");
-    sd_showStatus(tft, false);
-    SD_ready = false;
-    return false;
-  }
-
-  Serial.println("SD init OK");
-  sd_showStatus(tft, true);
-  SD_ready = true;
-
-  // Листинг корня
+static void sdPrintRoot() {
   File root = SD.open("/");
   if (!root) {
     Serial.println("SD open / FAILED");
-    return true; // SD есть, но корень не открылся (редко)
+    return;
   }
 
   while (true) {
@@ -54,6 +65,80 @@ static inline bool SD_init(Adafruit_ST7735 &tft) {
     f.close();
   }
   root.close();
+}
+
+static void sdUnmount(const char* why) {
+  if (!SD_ready) return;
+  SD.end();
+  SD_ready = false;
+  sdBackoffMs = 0;                    // карту вернут — монтируем сразу
+  Serial.printf("SD lost (%s)\n", why);
+}
 
+// Из setup(): без обращения к карте.
+// listRoot — список файлов корня в Serial при первом монтировании.
+static void sdBegin(bool listRoot) {
+  pinMode(SD_CS, OUTPUT);
+  digitalWrite(SD_CS, HIGH);   // SD не выбрана
+#if SD_CD_PIN >= 0
+  pinMode(SD_CD_PIN, INPUT_PULLUP);
+#endif
+  sdListRoot = listRoot;
+}
+
+// Перед каждым обращением к SD. false — карты нет (пока).
+// Шина переходит к SD (транзакция TFT должна быть закрыта).
+static bool sdEnsure() {
+  if (SD_ready) { spiBusClaim(SPI_DEV_SD); return true; }
+  if (!sdCardPresent()) return false;
+  if (sdBackoffMs && (int32_t)(millis() - sdRetryMs) < 0) return false;
+
+  uint32_t t0 = millis();
+  spiBusClaim(SPI_DEV_SD);
+  if (!SD.begin(SD_CS, SD_SPI_HZ)) {
+    sdBackoffMs = sdBackoffMs ? min<uint32_t>(sdBackoffMs * 2, SD_RETRY_MAX_MS) : SD_RETRY_MIN_MS;
+    sdRetryMs = millis() + sdBackoffMs;
+    Serial.printf("SD mount FAILED (%lu ms), retry in %lu ms\n", millis() - t0, (unsigned long)sdBackoffMs);
+    return false;
+  }
+
+  SD_ready = true;
+  sdBackoffMs = 0;
+  sdGen++;
+  Serial.printf("SD mount OK in %lu ms (#%u)\n", millis() - t0, sdGen);
+  if (sdListRoot) { sdListRoot = false; sdPrintRoot(); }
   return true;
-}
\ No newline at end of file
+}
+
+static inline uint32_t sdMountGen() { return sdGen; }
+
+// Файл не открылся или не прочитался: нет файла или нет карты?
+// Пустой или нечитаемый корень считаем потерей карты (пустая карта
+// просто перемонтируется). true — карта на месте.
+static bool sdIoFailed() {
+  if (!SD_ready) return false;
+  File root = SD.open("/");
+  bool ok = false;
+  if (root) {
+    File f = root.openNextFile();
+    ok = (bool)f;
+    if (f) f.close();
+    root.close();
+  }
+  if (!ok) sdUnmount("I/O error");
+  return ok;
+}
+
+// Из loop(): контакт card-detect (с фильтром дребезга).
+static void sdPoll() {
+#if SD_CD_PIN >= 0
+  static bool     last = true, stable = true;
+  static uint32_t changedMs = 0;
+  bool present = sdCardPresent();
+  if (present != last) { last = present; changedMs = millis(); return; }
+  if (present == stable || millis() - changedMs < 200) return;
+  stable = present;
+  if (!present) sdUnmount("card removed");
+  else sdBackoffMs = 0;               // вставили — монтировать без ожидания
+#endif
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sign_dl.h"
+
+// ===== Растеризация display list при компиляции =====
+// Геометрия встроенных знаков не меняется, поэтому display list
+// растеризуется компилятором (constexpr) теми же алгоритмами, что и
+// FastGfx::add* / Adafruit_GFX. В PROGMEM лежат готовые окна дисплея:
+// подряд идущие строки с одинаковым отрезком уже склеены в прямоугольник.
+// Только constexpr и sign_dl.h — собирается и на хосте
+// (host_test/sign_spans_test.cpp сверяет таблицы с Adafruit_GFX).
+//
+//   SIGN_SPANS(SIGN_LEFT_SV, SIGN_LEFT_DL);   // display list должен быть constexpr
+
+struct SignWin {
+  uint8_t x0, x1, y0, y1;    // включительно
+};
+
+template<size_t NW, size_t NG>
+struct SignSpanData {
+  uint8_t  groups;           // группа = подряд идущие слои одного цвета
+  uint16_t color[NG];
+  uint16_t end[NG];          // конец окон группы в win[]
+  SignWin  win[NW];
+};
+
+struct SignSpanView {
+  uint8_t         groups;
+  const uint16_t* color;     // всё в PROGMEM
+  const uint16_t* end;
+  const SignWin*  win;
+};
+
+namespace sign_ct {
+
+constexpr int W = SIGN_SCREEN_W;
+constexpr int H = SIGN_SCREEN_H;
+constexpr int WORDS = (W + 31) / 32;
+constexpr int MAX_OPEN = 8;   // отрезков в строке одной группы
+
+struct Mask {
+  uint32_t m[H][WORDS];
+};
+
+constexpr void swapi(int& a, int& b) { int t = a; a = b; b = t; }
+
+constexpr bool bit(const Mask& k, int y, int x) {
+  return (k.m[y][x >> 5] >> (x & 31)) & 1;
+}
+
+constexpr void span(Mask& k, int y, int x0, int x1) {
+  if (y < 0 || y >= H) return;
+  if (x0 < 0) x0 = 0;
+  if (x1 > W - 1) x1 = W - 1;
+  for (int x = x0; x <= x1; x++) k.m[y][x >> 5] |= (uint32_t)1 << (x & 31);
+}
+
+constexpr void circle(Mask& k, int x0, int y0, int r) {
+  if (r < 0 || r > W) return;
+  int colH[W + 1] = {};
+  for (int i = 1; i <= r; i++) colH[i] = -1;
+  colH[0] = r;
+  int f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r, px = x, py = y;
+  while (x < y) {
+    if (f >= 0) { y--; ddF_y += 2; f += ddF_y; }
+    x++; ddF_x += 2; f += ddF_x;
+    if (x < y + 1 && colH[x] < y) colH[x] = y;
+    if (y != py) { if (colH[py] < px) colH[py] = px; py = y; }
+    px = x;
+  }
+  int dx = r;
+  for (int dy = 0; dy <= r; dy++) {
+    while (dx > 0 && colH[dx] < dy) dx--;
+    span(k, y0 - dy, x0 - dx, x0 + dx);
+    span(k, y0 + dy, x0 - dx, x0 + dx);
+  }
+}
+
+constexpr void rect(Mask& k, int x, int y, int w, int h) {
+  if (w < 0) { x += w + 1; w = -w; }
+  if (h < 0) { y += h + 1; h = -h; }
+  for (int j = 0; j < h; j++) span(k, y + j, x, x + w - 1);
+}
+
+constexpr void tri(Mask& k, int x0, int y0, int x1, int y1, int x2, int y2) {
+  if (y0 > y1) { swapi(y0, y1); swapi(x0, x1); }
+  if (y1 > y2) { swapi(y2, y1); swapi(x2, x1); }
+  if (y0 > y1) { swapi(y0, y1); swapi(x0, x1); }
+  if (y0 == y2) {
+    int a = x0, b = x0;
+    if (x1 < a) a = x1; else if (x1 > b) b = x1;
+    if (x2 < a) a = x2; else if (x2 > b) b = x2;
+    span(k, y0, a, b);
+    return;
+  }
+  int dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0,
+      dx12 = x2 - x1, dy12 = y2 - y1;
+  int32_t sa = 0, sb = 0;
+  int y = y0;
+  int last = (y1 == y2) ? y1 : y1 - 1;
+  for (; y <= last; y++) {
+    int a = x0 + sa / dy01, b = x0 + sb / dy02;
+    sa += dx01; sb += dx02;
+    if (a > b) swapi(a, b);
+    span(k, y, a, b);
+  }
+  sa = (int32_t)dx12 * (y - y1);
+  sb = (int32_t)dx02 * (y - y0);
+  for (; y <= y2; y++) {
+    int a = x1 + sa / dy12, b = x0 + sb / dy02;
+    sa += dx12; sb += dx02;
+    if (a > b) swapi(a, b);
+    span(k, y, a, b);
+  }
+}
+
+constexpr void stroke(Mask& k, int x0, int y0, int x1, int y1, int half) {
+  bool steep = (y1 > y0 ? y1 - y0 : y0 - y1) > (x1 > x0 ? x1 - x0 : x0 - x1);
+  if (steep) { swapi(x0, y0); swapi(x1, y1); }
+  if (x0 > x1) { swapi(x0, x1); swapi(y0, y1); }
+  int dx = x1 - x0, dy = (y1 > y0) ? y1 - y0 : y0 - y1;
+  int err = dx / 2;
+  int ystep = (y0 < y1) ? 1 : -1;
+  for (; x0 <= x1; x0++) {
+    if (steep) span(k, x0, y0 - half, y0 + half);
+    else for (int i = -half; i <= half; i++) span(k, y0 + i, x0, x0);
+    err -= dy;
+    if (err < 0) { y0 += ystep; err += dx; }
+  }
+}
+
+// Маска группы -> окна: отрезок, повторяющийся в следующей строке,
+// продлевает окно вниз.
+template<class Sink>
+constexpr void emit(const Mask& k, Sink& out) {
+  SignWin open[MAX_OPEN] = {};
+  int nOpen = 0;
+  for (int y = 0; y <= H; y++) {
+    SignWin next[MAX_OPEN] = {};
+    bool used[MAX_OPEN] = {};
+    int nNext = 0;
+    for (int x = 0; y < H && x < W; ) {
+      if (!bit(k, y, x)) { x++; continue; }
+      int x0 = x;
+      while (x < W && bit(k, y, x)) x++;
+      int x1 = x - 1;
+
+      int j = 0;
+      while (j < nOpen && (used[j] || open[j].x0 != x0 || open[j].x1 != x1)) j++;
+      if (j < nOpen) {
+        used[j] = true;
+        next[nNext] = open[j];
+        next[nNext].y1 = (uint8_t)y;
+      } else {
+        next[nNext] = SignWin{ (uint8_t)x0, (uint8_t)x1, (uint8_t)y, (uint8_t)y };
+      }
+      nNext++;
+    }
+    for (int j = 0; j < nOpen; j++) if (!used[j]) out.win(open[j]);
+    for (int j = 0; j < nNext; j++) open[j] = next[j];
+    nOpen = nNext;
+  }
+}
+
+template<class Sink, size_t N>
+constexpr void build(const uint8_t (&dl)[N], Sink& out) {
+  Mask k = {};
+  bool inGroup = false;
+  uint16_t color = ST77XX_WHITE, groupColor = 0;
+  size_t i = 0;
+  while (i < N) {
+    uint8_t op = dl[i++];
+    if (op == DL_END) break;
+    if (op == DL_COLOR) {
+      color = (uint16_t)(dl[i] | (dl[i + 1] << 8));
+      i += 2;
+      continue;
+    }
+    int p[6] = {};
+    uint8_t argc = signArgCount(op);
+    for (uint8_t j = 0; j < argc; j++) p[j] = (int16_t)(dl[i + j * 2] | (dl[i + j * 2 + 1] << 8));
+    i += argc * 2;
+
+    if (!inGroup || color != groupColor) {
+      if (inGroup) { emit(k, out); out.endGroup(); k = Mask{}; }
+      out.group(color);
+      groupColor = color;
+      inGroup = true;
+    }
+    switch (op) {
+      case SL_CIRCLE: circle(k, p[0], p[1], p[2]); break;
+      case SL_RECT:   rect(k, p[0], p[1], p[2], p[3]); break;
+      case SL_TRI:    tri(k, p[0], p[1], p[2], p[3], p[4], p[5]); break;
+      case SL_STROKE: stroke(k, p[0], p[1], p[2], p[3], p[4]); break;
+    }
+  }
+  if (inGroup) { emit(k, out); out.endGroup(); }
+}
+
+struct Count {
+  size_t wins = 0, groups = 0;
+  constexpr void group(uint16_t) { groups++; }
+  constexpr void endGroup() {}
+  constexpr void win(const SignWin&) { wins++; }
+};
+
+template<size_t N>
+constexpr Count count(const uint8_t (&dl)[N]) {
+  Count c;
+  build(dl, c);
+  return c;
+}
+
+template<size_t NW, size_t NG>
+struct Fill {
+  SignSpanData<NW, NG> d = {};
+  uint16_t nw = 0;
+  constexpr void group(uint16_t c) { d.color[d.groups++] = c; }
+  constexpr void endGroup() { d.end[d.groups - 1] = nw; }
+  constexpr void win(const SignWin& w) { d.win[nw++] = w; }
+};
+
+template<size_t NW, size_t NG, size_t N>
+constexpr SignSpanData<NW, NG> fill(const uint8_t (&dl)[N]) {
+  Fill<NW, NG> f;
+  build(dl, f);
+  return f.d;
+}
+
+} // namespace sign_ct
+
+#define SIGN_SPANS(var, dl) \
+  static constexpr sign_ct::Count var##_N = sign_ct::count(dl); \
+  static constexpr SignSpanData<(var##_N.wins ? var##_N.wins : 1), (var##_N.groups ? var##_N.groups : 1)> var##_DATA PROGMEM = \
+    sign_ct::fill<(var##_N.wins ? var##_N.wins : 1), (var##_N.groups ? var##_N.groups : 1)>(dl); \
+  static const SignSpanView var = { var##_DATA.groups, var##_DATA.color, var##_DATA.end, var##_DATA.win }
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+
+// ===== Формат display list знака (int16 little-endian) =====
+// Компактный байткод (PROGMEM или файл /signs/<name>.sgn на SD):
+//   DL_COLOR  c16                   — текущий цвет для следующих команд
+//   SL_CIRCLE x y r
+//   SL_RECT   x y w h
+//   SL_TRI    x0 y0 x1 y1 x2 y2
+//   SL_STROKE x0 y0 x1 y1 half
+//   DL_END
+
+enum SignLayerKind : uint8_t {
+  SL_CIRCLE  = 1,   // p: x, y, r
+  SL_RECT    = 2,   // p: x, y, w, h
+  SL_TRI     = 3,   // p: x0, y0, x1, y1, x2, y2
+  SL_STROKE  = 4,   // p: x0, y0, x1, y1, half — линия толщиной ±half по малой оси
+};
+
+enum : uint8_t {
+  DL_END   = 0x00,
+  DL_COLOR = 0x80,
+};
+
+static constexpr uint8_t signArgCount(uint8_t kind) {
+  return kind == SL_CIRCLE ? 3 :
+         kind == SL_RECT   ? 4 :
+         kind == SL_TRI    ? 6 :
+         kind == SL_STROKE ? 5 : 0;
+}
+
+static constexpr uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+#define SIGN_BG      ST77XX_BLACK
+#define SIGN_BLUE    rgb565(0, 80, 200)
+#define SIGN_GREEN   rgb565(0, 160, 60)
+#define SIGN_RED     rgb565(200, 0, 0)
+
+// экран знаков: ST7735 160x128, setRotation(1)
+#define SIGN_SCREEN_W 160
+#define SIGN_SCREEN_H 128
+
+#ifndef SIGN_MAX_DL
+  #define SIGN_MAX_DL 512       // максимальный размер файла знака с SD
+#endif
+
+// ---- макросы для записи display list в исходнике ----
+#define DL_I16(v)                  (uint8_t)((v) & 0xFF), (uint8_t)(((v) >> 8) & 0xFF)
+#define DL_C(c)                    DL_COLOR, DL_I16(c)
+#define DL_CIRC(x, y, r)           SL_CIRCLE, DL_I16(x), DL_I16(y), DL_I16(r)
+#define DL_RECT(x, y, w, h)        SL_RECT, DL_I16(x), DL_I16(y), DL_I16(w), DL_I16(h)
+#define DL_TRI(a, b, c, d, e, f)   SL_TRI, DL_I16(a), DL_I16(b), DL_I16(c), DL_I16(d), DL_I16(e), DL_I16(f)
+#define DL_STROKE(a, b, c, d, h)   SL_STROKE, DL_I16(a), DL_I16(b), DL_I16(c), DL_I16(d), DL_I16(h)
@@ -0,0 +1,416 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_ST7735.h>
+#include <SD.h>
+
+#include "fast_gfx.h"
+#include "metrics.h"
+#include "trace.h"
+#include "sign_dl.h"
+#include "sign_spans.h"
+#include "sign_tables.h"
+#include "panel_config.h"
+#include "sd_test.h"
+
+// ===== Модель знака: набор слоёв поверх чёрного фона =====
+// Каждый слой — один примитив одного цвета. При смене знака
+// перерисовываются только прямоугольники слоёв, которые отличаются
+// у старого и нового знака (общий синий круг не трогаем).
+//
+// Знаки хранятся как display list (формат — sign_dl.h), который
+// исполняет один рендерер. Для встроенных знаков компилятор заранее
+// раскладывает список в окна дисплея (sign_spans.h).
+
+struct SignLayer {
+  uint8_t  kind;
+  uint16_t color;
+  int16_t  p[6];
+};
+
+struct SignDef {
+  const char*         name;
+  const uint8_t*      dl;    // в PROGMEM
+  uint16_t            len;
+  const SignSpanView* sv;    // готовые окна (sign_spans.h) или nullptr
+};
+
+struct SignRect {
+  int16_t x0, y0, x1, y1;    // включительно
+};
+
+#ifndef SIGN_MAX_LAYERS
+  #define SIGN_MAX_LAYERS 16
+#endif
+
+// Пределы параметров слоя (список с SD — недоверенный): координаты —
+// экран с запасом, радиус и полутолщина — не больше экрана.
+#define SIGN_COORD_MIN  -160
+#define SIGN_COORD_MAX   320
+#define SIGN_SIZE_MAX    320      // |w|, |h| прямоугольника
+#define SIGN_RADIUS_MAX  159      // addCircle: r < FG_MAX_ROWS
+#define SIGN_HALF_MAX     64
+
+#define SIGN_DEF(n, arr, sv) { n, arr, (uint16_t)sizeof(arr), &sv }
+
+static const SignDef SIGN_LEFT  = SIGN_DEF("left",  SIGN_LEFT_DL,  SIGN_LEFT_SV);
+static const SignDef SIGN_RIGHT = SIGN_DEF("right", SIGN_RIGHT_DL, SIGN_RIGHT_SV);
+static const SignDef SIGN_BACK  = SIGN_DEF("back",  SIGN_BACK_DL,  SIGN_BACK_SV);
+static const SignDef SIGN_GO    = SIGN_DEF("go",    SIGN_GO_DL,    SIGN_GO_SV);
+static const SignDef SIGN_STOP  = SIGN_DEF("stop",  SIGN_STOP_DL,  SIGN_STOP_SV);
+static const SignDef SIGN_BLANK = SIGN_DEF("blank", SIGN_BLANK_DL, SIGN_BLANK_SV);
+
+// встроенные знаки для /api/sign?name=
+// индекс в таблице — id знака в UDP протоколе (udp_control.h): только дописывать в конец
+static const SignDef SIGN_TABLE[] = {
+  SIGN_LEFT, SIGN_RIGHT, SIGN_BACK, SIGN_GO, SIGN_STOP, SIGN_BLANK,
+  SIGN_DEF("road_left",  ROAD_LEFT_DL,  ROAD_LEFT_SV),
+  SIGN_DEF("road_right", ROAD_RIGHT_DL, ROAD_RIGHT_SV),
+  SIGN_DEF("road_back",  ROAD_BACK_DL,  ROAD_BACK_SV),
+  SIGN_DEF("road_go",    ROAD_GO_DL,    ROAD_GO_SV),
+  SIGN_DEF("road_cross", ROAD_CROSS_DL, ROAD_CROSS_SV),
+};
+
+// ---- helpers ----
+static inline bool signInRange(int16_t v, int16_t lo, int16_t hi) { return v >= lo && v <= hi; }
+
+// Параметры слоя в пределах: иначе растеризаторы крутятся до сторожевого таймера.
+static bool signLayerOk(const SignLayer& L) {
+  const int16_t* p = L.p;
+  switch (L.kind) {
+    case SL_CIRCLE:
+      return signInRange(p[0], SIGN_COORD_MIN, SIGN_COORD_MAX) && signInRange(p[1], SIGN_COORD_MIN, SIGN_COORD_MAX) &&
+             signInRange(p[2], 0, SIGN_RADIUS_MAX);
+    case SL_RECT:
+      return signInRange(p[0], SIGN_COORD_MIN, SIGN_COORD_MAX) && signInRange(p[1], SIGN_COORD_MIN, SIGN_COORD_MAX) &&
+             signInRange(p[2], -SIGN_SIZE_MAX, SIGN_SIZE_MAX) && signInRange(p[3], -SIGN_SIZE_MAX, SIGN_SIZE_MAX);
+    case SL_TRI:
+      for (uint8_t k = 0; k < 6; k++) if (!signInRange(p[k], SIGN_COORD_MIN, SIGN_COORD_MAX)) return false;
+      return true;
+    case SL_STROKE:
+      for (uint8_t k = 0; k < 4; k++) if (!signInRange(p[k], SIGN_COORD_MIN, SIGN_COORD_MAX)) return false;
+      return signInRange(p[4], 0, SIGN_HALF_MAX);
+  }
+  return false;
+}
+
+// Разбирает display list в слои. progmem=false — список в RAM (с SD).
+// Возвращает число слоёв или -1, если список битый или параметры вне пределов.
+static int signDecode(const uint8_t* dl, uint16_t len, bool progmem, SignLayer* out, uint8_t maxLayers) {
+  auto rd = [&](uint16_t i) -> uint8_t { return progmem ? pgm_read_byte(dl + i) : dl[i]; };
+
+  uint16_t color = ST77XX_WHITE;
+  uint16_t i = 0;
+  int n = 0;
+  while (i < len) {
+    uint8_t op = rd(i++);
+    if (op == DL_END) return n;
+    if (op == DL_COLOR) {
+      if (i + 2 > len) return -1;
+      color = (uint16_t)(rd(i) | (rd(i + 1) << 8));
+      i += 2;
+      continue;
+    }
+    uint8_t argc = signArgCount(op);
+    if (!argc || i + argc * 2 > len || n >= maxLayers) return -1;
+
+    SignLayer& L = out[n++];
+    L.kind = op;
+    L.color = color;
+    for (uint8_t k = 0; k < 6; k++) {
+      L.p[k] = (k < argc) ? (int16_t)(rd(i + k * 2) | (rd(i + k * 2 + 1) << 8)) : 0;
+    }
+    if (!signLayerOk(L)) return -1;
+    i += argc * 2;
+  }
+  return -1;   // нет DL_END
+}
+
+static inline bool signLayerEq(const SignLayer& a, const SignLayer& b) {
+  if (a.kind != b.kind || a.color != b.color) return false;
+  for (int i = 0; i < 6; i++) if (a.p[i] != b.p[i]) return false;
+  return true;
+}
+
+static SignRect signLayerBounds(const SignLayer& L) {
+  const int16_t* p = L.p;
+  SignRect r;
+  switch (L.kind) {
+    case SL_CIRCLE:
+      r = { (int16_t)(p[0] - p[2]), (int16_t)(p[1] - p[2]), (int16_t)(p[0] + p[2]), (int16_t)(p[1] + p[2]) };
+      break;
+    case SL_RECT:
+      r = { p[0], p[1], (int16_t)(p[0] + p[2] - 1), (int16_t)(p[1] + p[3] - 1) };
+      break;
+    case SL_TRI:
+      r.x0 = min(p[0], min(p[2], p[4])); r.x1 = max(p[0], max(p[2], p[4]));
+      r.y0 = min(p[1], min(p[3], p[5])); r.y1 = max(p[1], max(p[3], p[5]));
+      break;
+    case SL_STROKE:
+    default: {
+      bool steep = abs(p[3] - p[1]) > abs(p[2] - p[0]);
+      int16_t hx = steep ? p[4] : 0, hy = steep ? 0 : p[4];
+      r.x0 = (int16_t)(min(p[0], p[2]) - hx); r.x1 = (int16_t)(max(p[0], p[2]) + hx);
+      r.y0 = (int16_t)(min(p[1], p[3]) - hy); r.y1 = (int16_t)(max(p[1], p[3]) + hy);
+      break;
+    }
+  }
+  return r;
+}
+
+static inline bool signRectsTouch(const SignRect& a, const SignRect& b) {
+  return a.x0 <= b.x1 + 1 && b.x0 <= a.x1 + 1 && a.y0 <= b.y1 + 1 && b.y0 <= a.y1 + 1;
+}
+
+// Рисует слой в любой GFX-цели со сдвигом (ox, oy) — для холста-полосы.
+static void signDrawLayer(Adafruit_GFX& g, const SignLayer& L, int16_t ox, int16_t oy) {
+  const int16_t* p = L.p;
+  switch (L.kind) {
+    case SL_CIRCLE:
+      g.fillCircle(p[0] + ox, p[1] + oy, p[2], L.color);
+      break;
+    case SL_RECT:
+      g.fillRect(p[0] + ox, p[1] + oy, p[2], p[3], L.color);
+      break;
+    case SL_TRI:
+      g.fillTriangle(p[0] + ox, p[1] + oy, p[2] + ox, p[3] + oy, p[4] + ox, p[5] + oy, L.color);
+      break;
+    case SL_STROKE: {
+      bool steep = abs(p[3] - p[1]) > abs(p[2] - p[0]);
+      for (int i = -p[4]; i <= p[4]; i++) {
+        int16_t dx = steep ? i : 0, dy = steep ? 0 : i;
+        g.drawLine(p[0] + ox + dx, p[1] + oy + dy, p[2] + ox + dx, p[3] + oy + dy, L.color);
+      }
+      break;
+    }
+  }
+}
+
+// То же на дисплей напрямую — отрезками (fast_gfx.h), пиксель в пиксель.
+static void signDrawLayerFast(FastGfx& fg, const SignLayer& L) {
+  const int16_t* p = L.p;
+  switch (L.kind) {
+    case SL_CIRCLE: fg.fillCircle(p[0], p[1], p[2], L.color); break;
+    case SL_RECT:   fg.fillRect(p[0], p[1], p[2], p[3], L.color); break;
+    case SL_TRI:    fg.fillTriangle(p[0], p[1], p[2], p[3], p[4], p[5], L.color); break;
+    case SL_STROKE: fg.drawThickLine(p[0], p[1], p[2], p[3], p[4], L.color); break;
+  }
+}
+
+// ---- dirty-region redraw ----
+#ifndef SIGN_MAX_DIRTY
+  #define SIGN_MAX_DIRTY 8
+#endif
+#ifndef SIGN_STRIP_H
+  #define SIGN_STRIP_H 16   // высота полосы холста: 160*16*2 = 5 КБ максимум
+#endif
+
+// что сейчас на экране (копия слоёв — список с SD может быть перезаписан)
+static SignLayer signCur[SIGN_MAX_LAYERS];
+static uint8_t   signCurCount = 0;
+static bool      signCurValid = false;   // false = на экране что-то постороннее
+static char      signCurName[25] = "";
+static uint32_t  signGen = 0;            // растёт при каждой смене экрана
+
+// Вызывать, когда экран перерисован не через signShow (BMP, текст, очистка).
+static inline void signInvalidate() {
+  if (signCurValid) signGen++;
+  signCurValid = false;
+}
+
+// Имя знака на экране или "" (на экране не знак).
+static inline const char* signCurrentName() {
+  return signCurValid ? signCurName : "";
+}
+
+static void signAddDirty(SignRect* rects, uint8_t& n, SignRect r, int16_t w, int16_t h) {
+  if (r.x0 < 0) r.x0 = 0;
+  if (r.y0 < 0) r.y0 = 0;
+  if (r.x1 > w - 1) r.x1 = w - 1;
+  if (r.y1 > h - 1) r.y1 = h - 1;
+  if (r.x0 > r.x1 || r.y0 > r.y1) return;
+
+  // сливаем с пересекающимися, пока есть что сливать
+  for (uint8_t i = 0; i < n; ) {
+    if (signRectsTouch(rects[i], r)) {
+      r.x0 = min(r.x0, rects[i].x0); r.y0 = min(r.y0, rects[i].y0);
+      r.x1 = max(r.x1, rects[i].x1); r.y1 = max(r.y1, rects[i].y1);
+      rects[i] = rects[--n];
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+  if (n < SIGN_MAX_DIRTY) { rects[n++] = r; return; }
+
+  // переполнение — расширяем последний
+  SignRect& t = rects[n - 1];
+  t.x0 = min(t.x0, r.x0); t.y0 = min(t.y0, r.y0);
+  t.x1 = max(t.x1, r.x1); t.y1 = max(t.y1, r.y1);
+}
+
+// Перерисовывает прямоугольник целиком: фон + все слои знака,
+// через холст-полосу и один setAddrWindow на полосу.
+static bool signRepaintRect(Adafruit_ST7735& tft, const SignLayer* layers, uint8_t count, const SignRect& r) {
+  int16_t w = r.x1 - r.x0 + 1;
+  int16_t h = r.y1 - r.y0 + 1;
+  int16_t stripH = (h < SIGN_STRIP_H) ? h : SIGN_STRIP_H;
+
+  GFXcanvas16 strip(w, stripH);
+  if (!strip.getBuffer()) return false;   // нет памяти
+
+  for (int16_t sy = 0; sy < h; sy += stripH) {
+    int16_t rows = (h - sy < stripH) ? (h - sy) : stripH;
+    SignRect band = { r.x0, (int16_t)(r.y0 + sy), r.x1, (int16_t)(r.y0 + sy + rows - 1) };
+
+    strip.fillScreen(SIGN_BG);
+    for (uint8_t i = 0; i < count; i++) {
+      SignRect b = signLayerBounds(layers[i]);
+      if (b.x1 < band.x0 || b.x0 > band.x1 || b.y1 < band.y0 || b.y0 > band.y1) continue;
+      signDrawLayer(strip, layers[i], -band.x0, -band.y0);
+    }
+    fgBeginTx(tft);
+    tft.setAddrWindow(band.x0, band.y0, w, rows);
+    tft.writePixels(strip.getBuffer(), (uint32_t)w * rows);
+    fgEndTx(tft);
+  }
+  return true;
+}
+
+static void signAddLayer(FastGfx& fg, const SignLayer& L) {
+  const int16_t* p = L.p;
+  switch (L.kind) {
+    case SL_CIRCLE: fg.addCircle(p[0], p[1], p[2]); break;
+    case SL_RECT:   fg.addRect(p[0], p[1], p[2], p[3]); break;
+    case SL_TRI:    fg.addTriangle(p[0], p[1], p[2], p[3], p[4], p[5]); break;
+    case SL_STROKE: fg.addThickLine(p[0], p[1], p[2], p[3], p[4]); break;
+  }
+}
+
+// Полная отрисовка. Подряд идущие слои одного цвета перестановочны,
+// поэтому их отрезки собираются в один буфер и уходят одним проходом
+// (общие строки сливаются). Слои разных цветов порядок сохраняют.
+static void signDrawFull(Adafruit_ST7735& tft, const SignLayer* layers, uint8_t count) {
+  FastGfx fg(tft);
+  fg.startWrite();
+  fg.fillScreen(SIGN_BG);
+  for (uint8_t i = 0; i < count; ) {
+    uint8_t j = i + 1;
+    while (j < count && layers[j].color == layers[i].color) j++;
+
+    if (j - i == 1) {
+      signDrawLayerFast(fg, layers[i]);
+    } else {
+      fg.beginBatch(layers[i].color);
+      for (uint8_t k = i; k < j; k++) signAddLayer(fg, layers[k]);
+      fg.endBatch();
+    }
+    i = j;
+  }
+  fg.endWrite();
+}
+
+// Показать набор слоёв: если на экране другой известный знак — только отличия.
+// sv — готовые окна знака (встроенные знаки), тогда геометрия не считается.
+static void signShowLayers(Adafruit_ST7735& tft, const char* name, const SignLayer* layers, uint8_t count,
+                           const SignSpanView* sv = nullptr) {
+  bool had = signCurValid;
+  uint8_t prevCount = signCurCount;
+
+  // общий префикс слоёв остаётся на экране как есть
+  uint8_t common = 0;
+  while (had && common < prevCount && common < count &&
+         signLayerEq(signCur[common], layers[common])) {
+    common++;
+  }
+  if (had && common == prevCount && common == count) return;   // тот же знак
+
+  bool full = !had;
+  SignRect rects[SIGN_MAX_DIRTY];
+  uint8_t n = 0;
+  uint32_t px = 0;
+  if (!full) {
+    for (uint8_t i = common; i < prevCount; i++) signAddDirty(rects, n, signLayerBounds(signCur[i]), tft.width(), tft.height());
+    for (uint8_t i = common; i < count; i++)     signAddDirty(rects, n, signLayerBounds(layers[i]), tft.width(), tft.height());
+    for (uint8_t i = 0; i < n; i++) px += (uint32_t)(rects[i].x1 - rects[i].x0 + 1) * (rects[i].y1 - rects[i].y0 + 1);
+
+    // если отличий почти на весь экран — дешевле нарисовать заново
+    if (px * 2 > (uint32_t)tft.width() * tft.height()) full = true;
+  }
+
+  if (!full) {
+    for (uint8_t i = 0; i < n; i++) {
+      if (sv) signRepaintSpans(tft, *sv, rects[i].x0, rects[i].y0, rects[i].x1, rects[i].y1);
+      else if (!signRepaintRect(tft, layers, count, rects[i])) { full = true; break; }
+    }
+  }
+  if (full) {
+    if (sv) signDrawSpans(tft, *sv);
+    else    signDrawFull(tft, layers, count);
+  }
+
+  memcpy(signCur, layers, count * sizeof(SignLayer));
+  signCurCount = count;
+  signCurValid = true;
+  strncpy(signCurName, name, sizeof(signCurName) - 1);
+  signGen++;
+
+  FgStats& st = fgStats[FG_SIGN];       // /api/gfx
+  st.calls++;
+  if (full) { st.full++; st.pixels += (uint32_t)tft.width() * tft.height(); }
+  else      { st.windows += n; st.pixels += px; }
+}
+
+static bool signShow(Adafruit_ST7735& tft, const SignDef& s) {
+  METRIC_DRAW(MD_SIGN);
+  SignLayer layers[SIGN_MAX_LAYERS];
+  int n = signDecode(s.dl, s.len, true, layers, SIGN_MAX_LAYERS);
+  if (n < 0) return false;
+  signShowLayers(tft, s.name, layers, (uint8_t)n, s.sv);
+  return true;
+}
+
+// ---- знаки с SD: <signsDir>/<name>.sgn (тот же байткод), по умолчанию /signs ----
+static bool signNameOk(const String& name) {
+  if (name.length() == 0 || name.length() > 24) return false;
+  for (unsigned i = 0; i < name.length(); i++) {
+    char c = name[i];
+    if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+  }
+  return true;
+}
+
+static bool signShowFromSD(Adafruit_ST7735& tft, const String& name) {
+  METRIC_DRAW(MD_SIGN_SD);
+  if (!sdEnsure()) return false;
+  String path = String(panelSd.signsDir) + "/" + name + ".sgn";
+  TRACE_BEGIN(TR_SD_OPEN);
+  File f = SD.open(path, FILE_READ);
+  TRACE_END(TR_SD_OPEN);
+  if (!f) { sdIoFailed(); return false; }
+
+  static uint8_t buf[SIGN_MAX_DL];
+  size_t len = f.size();
+  if (len > sizeof(buf)) { f.close(); return false; }
+  TRACE_BEGIN(TR_SD_READ);
+  size_t want = len;
+  len = f.read(buf, len);
+  TRACE_END_ARG(TR_SD_READ, len);
+  f.close();
+  if (len != want) { sdIoFailed(); return false; }
+
+  SignLayer layers[SIGN_MAX_LAYERS];
+  int n = signDecode(buf, (uint16_t)len, false, layers, SIGN_MAX_LAYERS);
+  if (n < 0) return false;
+  signShowLayers(tft, name.c_str(), layers, (uint8_t)n);
+  return true;
+}
+
+// Сначала встроенные знаки, потом SD.
+static bool signShowByName(Adafruit_ST7735& tft, const String& name) {
+  if (!signNameOk(name)) return false;
+  for (const SignDef& s : SIGN_TABLE) {
+    if (name == s.name) return signShow(tft, s);
+  }
+  return signShowFromSD(tft, name);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_ST7735.h>
+
+#include "fast_gfx.h"
+#include "sign_ct.h"
+
+// ===== Таблицы окон для встроенных знаков =====
+// Таблицы строит компилятор (sign_ct.h, SIGN_SPANS); здесь — рисование
+// знака проходом по таблице, без вычислений геометрии.
+
+// ---- runtime: проход по таблице ----
+
+// Полный знак: фон + окна всех групп по порядку.
+static void signDrawSpans(Adafruit_ST7735& tft, const SignSpanView& v) {
+  FastGfx fg(tft);
+  fg.startWrite();
+  fg.fillScreen(SIGN_BG);
+  fgStats[FG_TABLE].calls++;
+  uint16_t w0 = 0;
+  for (uint8_t g = 0; g < v.groups; g++) {
+    uint16_t color = pgm_read_word(&v.color[g]);
+    uint16_t w1 = pgm_read_word(&v.end[g]);
+    for (uint16_t i = w0; i < w1; i++) {
+      SignWin w;
+      memcpy_P(&w, &v.win[i], sizeof(w));
+      fg.fillWindow(w.x0, w.y0, w.x1, w.y1, color);
+    }
+    w0 = w1;
+  }
+  fg.endWrite();
+}
+
+// Прямоугольник (x0..x1, y0..y1) по строкам: одно окно на весь
+// прямоугольник, строка собирается из окон таблицы, попавших в неё.
+static void signRepaintSpans(Adafruit_ST7735& tft, const SignSpanView& v,
+                             int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+  static uint16_t line[SIGN_SCREEN_W];
+  int16_t w = x1 - x0 + 1;
+  int16_t h = y1 - y0 + 1;
+
+  fgBeginTx(tft);
+  tft.setAddrWindow(x0, y0, w, h);
+  for (int16_t y = y0; y <= y1; y++) {
+    for (int16_t i = 0; i < w; i++) line[i] = SIGN_BG;
+
+    uint16_t w0 = 0;
+    for (uint8_t g = 0; g < v.groups; g++) {
+      uint16_t color = pgm_read_word(&v.color[g]);
+      uint16_t w1 = pgm_read_word(&v.end[g]);
+      for (uint16_t i = w0; i < w1; i++) {
+        SignWin win;
+        memcpy_P(&win, &v.win[i], sizeof(win));
+        if (y < win.y0 || y > win.y1) continue;
+        int16_t a = max((int16_t)win.x0, x0), b = min((int16_t)win.x1, x1);
+        for (int16_t x = a; x <= b; x++) line[x - x0] = color;
+      }
+      w0 = w1;
+    }
+    tft.writePixels(line, w);
+  }
+  fgEndTx(tft);
+
+  FgStats& st = fgStats[FG_TABLE];
+  st.windows++;
+  st.cmdBytes += 3;
+  st.dataBytes += 8 + (uint32_t)w * h * 2;
+}
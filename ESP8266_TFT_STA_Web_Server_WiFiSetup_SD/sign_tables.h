@@ -0,0 +1,95 @@
+#pragma once
+#include "sign_ct.h"
+
+// ===== Встроенные знаки: display list и таблицы окон =====
+// Отдельно от sign_model.h, чтобы собирались и на хосте
+// (host_test/sign_spans_test.cpp).
+
+// ---- знаки панели (геометрия из прежнего app_routes.h) ----
+static constexpr uint8_t SIGN_LEFT_DL[] PROGMEM = {
+  DL_C(SIGN_BLUE),    DL_CIRC(80, 64, 55),
+  DL_C(ST77XX_WHITE), DL_RECT(58, 58, 48, 12),                 // тело стрелки
+                      DL_TRI(48, 64, 62, 50, 62, 78),          // голова
+  DL_END
+};
+
+static constexpr uint8_t SIGN_RIGHT_DL[] PROGMEM = {
+  DL_C(SIGN_BLUE),    DL_CIRC(80, 64, 55),
+  DL_C(ST77XX_WHITE), DL_RECT(54, 58, 48, 12),
+                      DL_TRI(112, 64, 98, 50, 98, 78),
+  DL_END
+};
+
+static constexpr uint8_t SIGN_BACK_DL[] PROGMEM = {
+  DL_C(SIGN_BLUE),    DL_CIRC(80, 64, 55),
+  DL_C(ST77XX_WHITE), DL_RECT(74, 40, 12, 40),                 // вертикальное тело
+                      DL_TRI(80, 88, 62, 70, 98, 70),          // голова вниз
+                      DL_RECT(52, 40, 34, 12),                 // “крюк” влево
+                      DL_TRI(48, 46, 60, 34, 60, 58),
+  DL_END
+};
+
+static constexpr uint8_t SIGN_GO_DL[] PROGMEM = {
+  DL_C(SIGN_GREEN),   DL_CIRC(80, 64, 55),
+  DL_C(ST77XX_WHITE), DL_RECT(74, 48, 12, 40),
+                      DL_TRI(80, 32, 60, 56, 100, 56),
+  DL_END
+};
+
+static constexpr uint8_t SIGN_STOP_DL[] PROGMEM = {
+  DL_C(SIGN_RED),     DL_CIRC(80, 64, 55),
+  DL_C(ST77XX_WHITE), DL_STROKE(58, 42, 102, 86, 22),          // белый крест
+                      DL_STROKE(58, 86, 102, 42, 22),
+  DL_END
+};
+
+static constexpr uint8_t SIGN_BLANK_DL[] PROGMEM = { DL_END };
+
+// ---- знаки из ESP8266-TFT_STA_Web Server_WiFiSetup_Road (arrowLeft, redCross, ...) ----
+static constexpr uint8_t ROAD_LEFT_DL[] PROGMEM = {
+  DL_C(ST77XX_BLUE),  DL_CIRC(80, 64, 50),
+  DL_C(ST77XX_WHITE), DL_TRI(60, 64, 100, 40, 100, 88),
+  DL_END
+};
+
+static constexpr uint8_t ROAD_RIGHT_DL[] PROGMEM = {
+  DL_C(ST77XX_BLUE),  DL_CIRC(80, 64, 50),
+  DL_C(ST77XX_WHITE), DL_TRI(100, 64, 60, 40, 60, 88),
+  DL_END
+};
+
+static constexpr uint8_t ROAD_BACK_DL[] PROGMEM = {
+  DL_C(ST77XX_BLUE),  DL_CIRC(80, 64, 50),
+  DL_C(ST77XX_WHITE), DL_TRI(80, 30, 50, 80, 110, 80),
+  DL_END
+};
+
+static constexpr uint8_t ROAD_GO_DL[] PROGMEM = {
+  DL_C(ST77XX_GREEN), DL_TRI(80, 30, 50, 80, 110, 80),
+  DL_END
+};
+
+static constexpr uint8_t ROAD_CROSS_DL[] PROGMEM = {
+  DL_C(ST77XX_RED),   DL_RECT(55, 55, 50, 10),
+                      DL_RECT(75, 35, 10, 50),
+  DL_END
+};
+
+// все встроенные знаки: (таблица окон, display list)
+#define SIGN_BUILTIN_LIST(X) \
+  X(SIGN_LEFT_SV,  SIGN_LEFT_DL) \
+  X(SIGN_RIGHT_SV, SIGN_RIGHT_DL) \
+  X(SIGN_BACK_SV,  SIGN_BACK_DL) \
+  X(SIGN_GO_SV,    SIGN_GO_DL) \
+  X(SIGN_STOP_SV,  SIGN_STOP_DL) \
+  X(SIGN_BLANK_SV, SIGN_BLANK_DL) \
+  X(ROAD_LEFT_SV,  ROAD_LEFT_DL) \
+  X(ROAD_RIGHT_SV, ROAD_RIGHT_DL) \
+  X(ROAD_BACK_SV,  ROAD_BACK_DL) \
+  X(ROAD_GO_SV,    ROAD_GO_DL) \
+  X(ROAD_CROSS_SV, ROAD_CROSS_DL)
+
+// окна встроенных знаков считает компилятор
+#define SIGN_SPANS_X(sv, dl) SIGN_SPANS(sv, dl);
+SIGN_BUILTIN_LIST(SIGN_SPANS_X)
+#undef SIGN_SPANS_X
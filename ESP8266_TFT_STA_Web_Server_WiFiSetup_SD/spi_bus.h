@@ -0,0 +1,210 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+#include <Adafruit_ST7735.h>
+
+#include "web_server.h"
+
+// ===== Общая шина SPI: TFT и SD =====
+// У каждого устройства своя частота: TFT — SPISettings внутри
+// Adafruit_SPITFT (setSPISpeed), SD — SPISettings библиотеки SD
+// (SD.begin(cs, hz)). Глобального SPI.setFrequency больше нет:
+// частота и CS меняются только в начале транзакции устройства.
+//
+// Работа идёт пачками: транзакция TFT держится на всю пачку отрисовки
+// (spiTftBegin/spiTftEnd, со вложенностью), чтение SD — между пачками
+// (spiBusClaim(SPI_DEV_SD)). SD при открытой транзакции TFT — ошибка
+// вызывающего: транзакция закрывается, счётчик conflicts растёт
+// (иначе байты SD ушли бы в дисплей с опущенным CS).
+//
+// Самотест при загрузке: шаблон пишется в GRAM на каждой частоте из
+// SPI_TFT_STEPS, читается обратно (RAMRD) на SPI_TFT_READ_HZ; выбирается
+// самая высокая частота, на которой прошли она и все ниже. Для чтения
+// нужен вывод SDO/SDA дисплея на MISO; без него чтение даёт 0x00/0xFF,
+// самотест это видит и оставляет SPI_TFT_FALLBACK_HZ. Частота из
+// настроек (panel_config.h, spi > 0) самотест отключает.
+//
+// GET /api/spi — частоты, пачки, переключения, результат самотеста.
+
+#ifndef SD_SPI_HZ
+  #define SD_SPI_HZ SPI_HALF_SPEED
+#endif
+#ifndef SPI_TFT_SELFTEST
+  #define SPI_TFT_SELFTEST 1
+#endif
+#ifndef SPI_TFT_READ_HZ
+  #define SPI_TFT_READ_HZ 4000000       // RAMRD у ST7735 медленнее записи
+#endif
+#ifndef SPI_TFT_FALLBACK_HZ
+  #define SPI_TFT_FALLBACK_HZ 4000000   // прежняя общая частота шины
+#endif
+#ifndef SPI_TFT_PASSES
+  #define SPI_TFT_PASSES 3
+#endif
+
+// делители 80 МГц, по возрастанию
+static const uint32_t SPI_TFT_STEPS[] = { 8000000, 10000000, 16000000, 20000000, 26666666, 40000000 };
+#define SPI_TFT_STEP_N (sizeof(SPI_TFT_STEPS) / sizeof(SPI_TFT_STEPS[0]))
+
+enum SpiDevId : uint8_t { SPI_DEV_TFT = 0, SPI_DEV_SD, SPI_DEV_COUNT };
+
+struct SpiDev {
+  const char* name;
+  uint32_t    hz;
+  uint32_t    batches;      // сколько раз шина переходила к устройству
+};
+
+static SpiDev  spiDevs[SPI_DEV_COUNT] = { { "tft", 0, 0 }, { "sd", SD_SPI_HZ, 0 } };
+static int8_t  spiOwner = -1;
+static uint32_t spiSwitches = 0, spiConflicts = 0;
+static uint8_t spiTftDepth = 0;
+static Adafruit_ST7735* spiTft = nullptr;
+
+// результат самотеста; бит i маски — прошла SPI_TFT_STEPS[i]
+static bool     spiTestRan = false, spiTestReadback = false;
+static uint8_t  spiTestPassMask = 0;
+static uint32_t spiTestBestHz = 0;
+
+static void spiBusClaim(SpiDevId dev) {
+  if (dev == SPI_DEV_SD && spiTftDepth) {
+    spiConflicts++;
+    spiTft->endWrite();
+    spiTftDepth = 0;
+  }
+  if (spiOwner == dev) return;
+  if (spiOwner >= 0) spiSwitches++;
+  spiOwner = dev;
+  spiDevs[dev].batches++;
+}
+
+// Транзакция TFT со вложенностью (у Adafruit startWrite/endWrite её нет).
+static inline void spiTftBegin() {
+  if (spiTftDepth++ == 0) { spiBusClaim(SPI_DEV_TFT); spiTft->startWrite(); }
+}
+static inline void spiTftEnd() {
+  if (spiTftDepth && --spiTftDepth == 0) spiTft->endWrite();
+}
+
+// Отпустить шину целиком на время SD и вернуть обратно.
+static inline uint8_t spiTftSuspend() {
+  uint8_t d = spiTftDepth;
+  if (d) { spiTft->endWrite(); spiTftDepth = 0; }
+  return d;
+}
+static inline void spiTftResume(uint8_t d) {
+  if (d) { spiBusClaim(SPI_DEV_TFT); spiTft->startWrite(); spiTftDepth = d; }
+}
+
+static void spiTftSetHz(uint32_t hz) {
+  spiDevs[SPI_DEV_TFT].hz = hz;
+  spiTft->setSPISpeed(hz);
+}
+
+// ---- самотест частоты дисплея ----
+
+static const uint16_t SPI_TEST_PAT[] = { 0xAAAA, 0x5555, 0xF800, 0x07E0, 0x001F, 0xFFFF, 0x0000, 0x1234,
+                                         0xEDCB, 0x8421, 0x7BDE, 0xC618, 0x39E7, 0x0F0F, 0xF0F0, 0xA5A5 };
+#define SPI_TEST_N (sizeof(SPI_TEST_PAT) / sizeof(SPI_TEST_PAT[0]))
+
+// Прочитать n пикселей из GRAM с (0,0): RAMRD отдаёт пустой байт и по
+// 3 байта на пиксель (RGB666, старшие биты), сравниваем с RGB565.
+static void spiTestRead(uint16_t* out, uint8_t n) {
+  spiTftSetHz(SPI_TFT_READ_HZ);
+  spiTftBegin();
+  spiTft->setAddrWindow(0, 0, n, 1);
+  spiTft->writeCommand(ST77XX_RAMRD);
+  SPI.transfer(0);                       // dummy
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t r = SPI.transfer(0), g = SPI.transfer(0), b = SPI.transfer(0);
+    out[i] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+  }
+  spiTftEnd();
+}
+
+static bool spiTestAt(uint32_t hz) {
+  uint16_t pat[SPI_TEST_N], back[SPI_TEST_N];
+  for (uint8_t pass = 0; pass < SPI_TFT_PASSES; pass++) {
+    // каждый проход — свой сдвиг, чтобы не прочитать прошлый
+    for (uint8_t i = 0; i < SPI_TEST_N; i++) pat[i] = SPI_TEST_PAT[(i + pass) % SPI_TEST_N];
+    spiTftSetHz(hz);
+    spiTftBegin();
+    spiTft->setAddrWindow(0, 0, SPI_TEST_N, 1);
+    spiTft->writePixels(pat, SPI_TEST_N);
+    spiTftEnd();
+    spiTestRead(back, SPI_TEST_N);
+    for (uint8_t i = 0; i < SPI_TEST_N; i++) {
+      if (back[i] != pat[i]) return false;
+    }
+  }
+  return true;
+}
+
+// Найти частоту TFT; fallbackHz — если чтения GRAM нет.
+static uint32_t spiTftSelfTest(uint32_t fallbackHz) {
+  spiTestRan = true;
+  spiTestPassMask = 0;
+  spiTestReadback = spiTestAt(SPI_TFT_READ_HZ);   // запись и чтение на медленной частоте
+  if (!spiTestReadback) {
+    Serial.println("SPI self-test: no TFT readback (SDO not wired), keeping configured clock");
+    spiTestBestHz = 0;
+    return fallbackHz;
+  }
+  uint32_t best = SPI_TFT_READ_HZ;
+  for (uint8_t i = 0; i < SPI_TFT_STEP_N; i++) {
+    if (!spiTestAt(SPI_TFT_STEPS[i])) break;
+    spiTestPassMask |= 1 << i;
+    best = SPI_TFT_STEPS[i];
+  }
+  spiTestBestHz = best;
+  Serial.printf("SPI self-test: TFT reliable up to %lu Hz\n", (unsigned long)best);
+  return best;
+}
+
+// Из setup() до initR().
+static void spiBusBegin(Adafruit_ST7735& tft) {
+  spiTft = &tft;
+  SPI.begin();
+}
+
+// После initR(): частота дисплея. configuredHz 0 — самотест.
+static void spiBusTftReady(uint32_t configuredHz) {
+  uint32_t hz = configuredHz ? configuredHz : SPI_TFT_FALLBACK_HZ;
+#if SPI_TFT_SELFTEST
+  if (!configuredHz) {
+    hz = spiTftSelfTest(SPI_TFT_FALLBACK_HZ);
+    spiTft->fillRect(0, 0, SPI_TEST_N, 1, ST77XX_BLACK);   // стереть шаблон
+  }
+#endif
+  spiTftSetHz(hz);
+  Serial.printf("SPI: tft %lu Hz, sd %lu Hz\n", (unsigned long)spiDevs[SPI_DEV_TFT].hz, (unsigned long)spiDevs[SPI_DEV_SD].hz);
+}
+
+static String spiBusJson() {
+  String s = "{\"owner\":\"" + String(spiOwner >= 0 ? spiDevs[spiOwner].name : "") + "\"";
+  s += ",\"switches\":" + String(spiSwitches);
+  s += ",\"conflicts\":" + String(spiConflicts);
+  s += ",\"devices\":[";
+  for (uint8_t i = 0; i < SPI_DEV_COUNT; i++) {
+    if (i) s += ",";
+    s += "{\"name\":\"" + String(spiDevs[i].name) + "\",\"hz\":" + String(spiDevs[i].hz) +
+         ",\"batches\":" + String(spiDevs[i].batches) + "}";
+  }
+  s += "],\"selftest\":{\"ran\":" + String(spiTestRan ? "true" : "false");
+  s += ",\"readback\":" + String(spiTestReadback ? "true" : "false");
+  s += ",\"best_hz\":" + String(spiTestBestHz) + ",\"passed\":[";
+  bool first = true;
+  for (uint8_t i = 0; i < SPI_TFT_STEP_N; i++) {
+    if (!(spiTestPassMask & (1 << i))) continue;
+    if (!first) s += ",";
+    first = false;
+    s += String(SPI_TFT_STEPS[i]);
+  }
+  s += "]}}";
+  return s;
+}
+
+static void spiBusRoutes(PanelWebServer& server) {
+  server.on("/api/spi", HTTP_GET, [&](){
+    server.send(200, "application/json", spiBusJson());
+  });
+}
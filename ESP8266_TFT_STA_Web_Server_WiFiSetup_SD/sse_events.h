@@ -0,0 +1,183 @@
+#pragma once
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+#include "web_server.h"
+#include "http_keepalive.h"
+#include "img_draw.h"
+#include "sign_model.h"
+#include "sd_test.h"
+
+// ===== GET /api/events — поток состояния (Server-Sent Events) =====
+// Вместо опроса: браузер открывает EventSource('/api/events') и
+// получает событие при каждом изменении:
+//   event: screen  data: {"sign":"left","image":""}      знак или BMP на экране
+//   event: sd      data: {"ready":true}                  SD_ready
+//   event: health  data: {"rssi":-61,"heap":23120}       раз в SSE_HEALTH_MS
+// Сразу после подключения приходит снимок всех трёх.
+//
+// События один раз пишутся в общее кольцо SSE_BUF_SIZE байт, у клиента
+// только позиция чтения. Клиент, отставший больше чем на кольцо,
+// отключается (EventSource сам переподключится и получит снимок) —
+// медленный клиент не копит память.
+
+#ifndef SSE_MAX_CLIENTS
+  #define SSE_MAX_CLIENTS 4
+#endif
+#ifndef SSE_BUF_SIZE
+  #define SSE_BUF_SIZE 2048
+#endif
+#ifndef SSE_HEALTH_MS
+  #define SSE_HEALTH_MS 2000
+#endif
+
+struct SseSub {
+#if PANEL_ASYNC_SERVER
+  AsyncClient* c;
+  bool         closing;
+#else
+  WiFiClient   c;
+  bool         used;
+#endif
+  uint32_t pos;          // сколько байт кольца уже отдано
+};
+
+static char     sseBuf[SSE_BUF_SIZE];
+static uint32_t sseHead = 0;          // всего байт записано в кольцо
+static SseSub   sseSubs[SSE_MAX_CLIENTS];
+
+static uint32_t sseSignGen = 0, sseImgGen = 0;
+static bool     sseSdReady = false;
+static uint32_t sseHealthMs = 0;
+
+// ---- транспорт: WiFiClient или AsyncClient ----
+#if PANEL_ASYNC_SERVER
+
+static inline bool   sseAlive(SseSub& s) { return s.c && !s.closing; }
+static inline bool   sseFree(SseSub& s)  { return !s.c; }   // closing ждёт onDisconnect
+static inline size_t sseSpace(SseSub& s) { return s.c->space(); }
+static inline void   sseWrite(SseSub& s, const char* p, size_t n) { s.c->add(p, n); s.c->send(); }
+static inline void   sseClose(SseSub& s) { s.closing = true; s.c->close(); }
+
+#else
+
+static inline bool   sseAlive(SseSub& s) {
+  if (s.used && !s.c.connected()) { s.c.stop(); s.used = false; }
+  return s.used;
+}
+static inline bool   sseFree(SseSub& s)  { return !sseAlive(s); }
+static inline size_t sseSpace(SseSub& s) { return s.c.availableForWrite(); }
+static inline void   sseWrite(SseSub& s, const char* p, size_t n) { s.c.write((const uint8_t*)p, n); }
+static inline void   sseClose(SseSub& s) { s.c.stop(); s.used = false; }
+
+#endif
+
+// ---- события ----
+
+static String sseScreenJson() {
+  const char* sign = signCurrentName();
+  return "{\"sign\":\"" + String(sign) + "\",\"image\":\"" + String(sign[0] ? "" : imgCurFile) + "\"}";
+}
+
+static String sseSdJson() {
+  return String("{\"ready\":") + (SD_ready ? "true" : "false") + "}";
+}
+
+static String sseHealthJson() {
+  return "{\"rssi\":" + String(WiFi.RSSI()) + ",\"heap\":" + String(ESP.getFreeHeap()) + "}";
+}
+
+static String sseFormat(const char* event, const String& data) {
+  return "event: " + String(event) + "\ndata: " + data + "\n\n";
+}
+
+static void ssePublish(const char* event, const String& data) {
+  String msg = sseFormat(event, data);
+  if (msg.length() > SSE_BUF_SIZE / 2) return;
+  for (unsigned i = 0; i < msg.length(); i++) sseBuf[(sseHead + i) % SSE_BUF_SIZE] = msg[i];
+  sseHead += msg.length();
+}
+
+// Отдать клиенту то, что влезает в его окно TCP, без ожидания.
+static void ssePump(SseSub& s) {
+  if (sseHead - s.pos > SSE_BUF_SIZE) {   // кольцо ушло вперёд
+    sseClose(s);
+    return;
+  }
+  while (s.pos != sseHead) {
+    uint32_t off = s.pos % SSE_BUF_SIZE;
+    size_t n = min<size_t>(sseHead - s.pos, SSE_BUF_SIZE - off);
+    n = min(n, sseSpace(s));
+    if (!n) break;
+    sseWrite(s, sseBuf + off, n);
+    s.pos += n;
+  }
+}
+
+// ---- маршрут ----
+
+static void sseHandleEvents(PanelWebServer& server) {
+  SseSub* s = nullptr;
+  for (SseSub& x : sseSubs) if (sseFree(x)) { s = &x; break; }
+  if (!s) { server.send(503, "text/plain", "Too many clients"); return; }
+
+  String head =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n\r\n"
+    "retry: 2000\n\n";
+  head += sseFormat("screen", sseScreenJson());
+  head += sseFormat("sd", sseSdJson());
+  head += sseFormat("health", sseHealthJson());
+
+#if PANEL_ASYNC_SERVER
+  AsyncClient* c = server.detachClient();
+  if (!c) return;
+  s->c = c;
+  s->closing = false;
+  c->onDisconnect([](void* p, AsyncClient* c) { ((SseSub*)p)->c = nullptr; delete c; }, s);
+#else
+  s->c = server.client();       // копия держит соединение после обработчика
+  s->c.setNoDelay(true);
+  s->used = true;
+  keepAliveRelease();
+#endif
+  sseWrite(*s, head.c_str(), head.length());   // снимок мал, окно TCP пустое
+  s->pos = sseHead;
+}
+
+static void sseEventsBegin(PanelWebServer& server) {
+  sseSignGen = signGen;
+  sseImgGen = imgGen;
+  sseSdReady = SD_ready;
+  server.on("/api/events", HTTP_GET, [&](){ sseHandleEvents(server); });
+}
+
+// Из loop(): заметить изменения и разослать.
+static void sseEventsLoop() {
+  bool any = false;
+  for (SseSub& s : sseSubs) any |= sseAlive(s);
+  if (!any) {
+    // без клиентов только помним текущее состояние
+    sseSignGen = signGen; sseImgGen = imgGen; sseSdReady = SD_ready;
+    return;
+  }
+
+  if (sseSignGen != signGen || sseImgGen != imgGen) {
+    sseSignGen = signGen;
+    sseImgGen = imgGen;
+    ssePublish("screen", sseScreenJson());
+  }
+  if (sseSdReady != SD_ready) {
+    sseSdReady = SD_ready;
+    ssePublish("sd", sseSdJson());
+  }
+  if (millis() - sseHealthMs >= SSE_HEALTH_MS) {
+    sseHealthMs = millis();
+    ssePublish("health", sseHealthJson());
+  }
+
+  for (SseSub& s : sseSubs) if (sseAlive(s)) ssePump(s);
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <Arduino.h>
+#include "web_server.h"
+
+// ===== Трасса горячих путей =====
+// Кольцо событий фиксированного размера в RAM: метка времени (мкс),
+// id события, фаза B/E (вход/выход), аргумент. Старые события
+// затираются, после сбоя видно, что происходило последние мгновения:
+// SD, SPI, Wi-Fi или веб-сервер.
+//
+// GET /api/trace — кольцо в формате Chrome trace-event JSON
+// (chrome://tracing, ui.perfetto.dev).
+//
+// TRACE_ENABLED 0 — макросы пустые, кольца и маршрута нет.
+
+#ifndef TRACE_ENABLED
+  #define TRACE_ENABLED 1
+#endif
+#ifndef TRACE_EVENTS
+  #define TRACE_EVENTS 512        // 8 байт на событие
+#endif
+
+enum TraceId : uint8_t {
+  TR_HTTP = 0,          // запрос: от хука сервера до конца handleClient
+  TR_BMP,               // drawBmpFromSD
+  TR_SD_OPEN,
+  TR_SD_SEEK,
+  TR_SD_READ,           // arg — байт
+  TR_WIFI_RESET_BTN,    // фазы подключения wifi_provision
+  TR_WIFI_CREDS,
+  TR_WIFI_CONNECT,
+  TR_WIFI_AP,
+  TR_COUNT
+};
+
+#if TRACE_ENABLED
+
+static const char* const TR_NAMES[TR_COUNT] = {
+  "http", "bmp", "sd_open", "sd_seek", "sd_read",
+  "wifi_reset_btn", "wifi_creds", "wifi_connect", "wifi_ap"
+};
+static const char* const TR_CATS[TR_COUNT] = {
+  "http", "draw", "sd", "sd", "sd", "wifi", "wifi", "wifi", "wifi"
+};
+
+struct TraceEv {
+  uint32_t us;
+  uint8_t  id;
+  char     ph;      // 'B' / 'E'
+  uint16_t arg;
+};
+
+static TraceEv  trRing[TRACE_EVENTS];
+static uint16_t trHead = 0;
+static bool     trWrapped = false;
+static bool     trPaused = false;   // на время выгрузки
+
+// пути запросов: arg события http — индекс здесь
+#define TRACE_PATHS 16
+static char    trPaths[TRACE_PATHS][24];
+static uint8_t trPathN = 0;
+static bool    trReqOpen = false;
+
+static inline void traceEv(uint8_t id, char ph, uint16_t arg = 0) {
+  if (trPaused) return;
+  TraceEv& e = trRing[trHead];
+  e.us = micros();
+  e.id = id;
+  e.ph = ph;
+  e.arg = arg;
+  if (++trHead == TRACE_EVENTS) { trHead = 0; trWrapped = true; }
+}
+
+class TraceScope {
+public:
+  explicit TraceScope(uint8_t id) : _id(id) { traceEv(_id, 'B'); }
+  ~TraceScope() { traceEv(_id, 'E'); }
+private:
+  uint8_t _id;
+};
+
+#define TRACE_BEGIN(id)           traceEv(id, 'B')
+#define TRACE_END(id)             traceEv(id, 'E')
+#define TRACE_END_ARG(id, arg)    traceEv(id, 'E', (uint16_t)(arg))
+#define TRACE_SCOPE(id)           TraceScope _traceScope(id)
+
+// Номер пути — только маршрутам server.on (web_server.h).
+static uint16_t trPathId(const String& url) {
+  if (!panelRouteKnown(url)) return 0xFFFF;
+  int q = url.indexOf('?');
+  String path = q < 0 ? url : url.substring(0, q);
+  for (uint8_t i = 0; i < trPathN; i++) {
+    if (path == trPaths[i]) return i;
+  }
+  if (trPathN >= TRACE_PATHS || path.length() >= sizeof(trPaths[0])) return 0xFFFF;
+  strncpy(trPaths[trPathN], path.c_str(), sizeof(trPaths[0]) - 1);
+  return trPathN++;
+}
+
+// Строка для JSON: кавычки, \ и управляющие символы экранируются.
+static String trJsonEsc(const char* v) {
+  String s;
+  for (; *v; v++) {
+    uint8_t c = (uint8_t)*v;
+    if (c == '\\' || c == '"') { s += '\\'; s += (char)c; }
+    else if (c < 0x20) { char u[7]; snprintf(u, sizeof(u), "\\u%04x", c); s += u; }
+    else s += (char)c;
+  }
+  return s;
+}
+
+static void trHandleDump(PanelWebServer& server) {
+  trPaused = true;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  server.sendContent("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  // от старого к новому; micros() переполняется раз в ~71 мин — разворачиваем
+  uint16_t n = trWrapped ? TRACE_EVENTS : trHead;
+  uint16_t pos = trWrapped ? trHead : 0;
+  uint64_t hi = 0;
+  uint32_t prev = 0;
+  String s;
+  for (uint16_t i = 0; i < n; i++) {
+    const TraceEv& e = trRing[(pos + i) % TRACE_EVENTS];
+    if (i && e.us < prev) hi += 0x100000000ULL;
+    prev = e.us;
+
+    if (i) s += ",";
+    s += "{\"name\":\"";
+    s += TR_NAMES[e.id];
+    s += "\",\"cat\":\"";
+    s += TR_CATS[e.id];
+    s += "\",\"ph\":\"";
+    s += e.ph;
+    s += "\",\"ts\":";
+    s += String((double)(hi + e.us), 0);
+    s += ",\"pid\":1,\"tid\":1";
+    if (e.id == TR_HTTP && e.ph == 'B' && e.arg < trPathN) {
+      s += ",\"args\":{\"path\":\"";
+      s += trJsonEsc(trPaths[e.arg]);
+      s += "\"}";
+    } else if (e.arg) {
+      s += ",\"args\":{\"v\":" + String(e.arg) + "}";
+    }
+    s += "}";
+
+    if (s.length() > 1024) { server.sendContent(s); s = ""; }
+  }
+  s += "]}";
+  server.sendContent(s);
+  server.sendContent("");
+  trPaused = false;
+}
+
+static void traceBegin(PanelWebServer& server) {
+  server.addHook([](const String&, const String& url, WiFiClient*, ESP8266WebServer::ContentTypeFunction) {
+    traceEv(TR_HTTP, 'B', trPathId(url));
+    trReqOpen = true;
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+  });
+  server.on("/api/trace", [&](){ trHandleDump(server); });
+}
+
+// В loop() сразу после handleClient: закрыть событие запроса.
+static inline void traceRequestEnd() {
+  if (!trReqOpen) return;
+  trReqOpen = false;
+  traceEv(TR_HTTP, 'E');
+}
+
+#else
+
+#define TRACE_BEGIN(id)           do {} while (0)
+#define TRACE_END(id)             do {} while (0)
+#define TRACE_END_ARG(id, arg)    do {} while (0)
+#define TRACE_SCOPE(id)           do {} while (0)
+
+static inline void traceBegin(PanelWebServer&) {}
+static inline void traceRequestEnd() {}
+
+#endif
@@ -0,0 +1,189 @@
+#pragma once
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "web_server.h"
+#include <Adafruit_ST7735.h>
+
+#include "sign_model.h"
+
+// ===== Бинарный UDP протокол команд знака =====
+// Для машинного управления (мост PLC, система зрения): один датаграм —
+// одна команда фиксированного формата, без TCP и разбора HTTP.
+//
+// Команда (18 байт, little-endian):
+//   'T' 'S' | ver | flags | seq u32 | sentMs u32 | ttlMs u16 | sign u8 | 0 | dlRef u16
+//     sign   — индекс в SIGN_TABLE (sign_model.h),
+//              0xFF — display list с SD: /signs/<dlRef>.sgn
+//     sentMs — часы отправителя (мс), нужны только для срока годности
+//     ttlMs  — срок годности при UC_F_DEADLINE
+//
+// Ответ (UC_F_ACK), 14 байт:
+//   'T' 'A' | ver | status | seq u32 | sentMs u32 (эхо) | procUs u16
+//
+// Порядок: команда с seq не новее последней принятой отбрасывается
+// (сравнение с переполнением). UC_F_RESET или новый отправитель
+// начинают счёт заново.
+//
+// Срок годности без общих часов: панель хранит минимум (local - sentMs)
+// по отправителю — это смещение часов плюс самая быстрая доставка.
+// Команда устарела, если она шла дольше минимума более чем на ttlMs.
+
+#ifndef UDP_CONTROL_PORT
+  #define UDP_CONTROL_PORT 4210
+#endif
+
+#define UC_VER          1
+#define UC_F_ACK        0x01
+#define UC_F_DEADLINE   0x02
+#define UC_F_RESET      0x04
+#define UC_SIGN_SD      0xFF
+
+enum UcStatus : uint8_t {
+  UC_OK = 0,
+  UC_STALE,       // срок годности истёк
+  UC_OLD_SEQ,     // повтор или не по порядку
+  UC_BAD_SIGN,    // нет такого знака
+  UC_BAD_PACKET,
+};
+
+struct __attribute__((packed)) UcCmd {
+  uint8_t  magic[2];
+  uint8_t  ver;
+  uint8_t  flags;
+  uint32_t seq;
+  uint32_t sentMs;
+  uint16_t ttlMs;
+  uint8_t  sign;
+  uint8_t  reserved;
+  uint16_t dlRef;
+};
+
+struct __attribute__((packed)) UcAck {
+  uint8_t  magic[2];
+  uint8_t  ver;
+  uint8_t  status;
+  uint32_t seq;
+  uint32_t sentMs;
+  uint16_t procUs;
+};
+
+// гистограмма времени от приёма до конца отрисовки, мкс
+static const uint32_t UC_HIST_US[] = { 500, 1000, 2000, 5000, 10000, 20000 };
+#define UC_HIST_N (sizeof(UC_HIST_US) / sizeof(UC_HIST_US[0]) + 1)
+
+struct UcStats {
+  uint32_t rx, ok, stale, oldSeq, badSign, badPacket;
+  uint32_t hist[UC_HIST_N];
+};
+
+static WiFiUDP          ucUdp;
+static Adafruit_ST7735* ucTft = nullptr;
+static UcStats          ucStats;
+
+// состояние последнего отправителя
+static IPAddress ucPeer;
+static uint16_t  ucPeerPort = 0;
+static bool      ucHaveSeq = false;
+static uint32_t  ucLastSeq = 0;
+static bool      ucHaveOffset = false;
+static int32_t   ucMinOffset = 0;
+
+static uint8_t ucHandle(const UcCmd& c, uint32_t now) {
+  // новый отправитель — своя нумерация и свои часы
+  if (ucUdp.remoteIP() != ucPeer || ucUdp.remotePort() != ucPeerPort || (c.flags & UC_F_RESET)) {
+    ucPeer = ucUdp.remoteIP();
+    ucPeerPort = ucUdp.remotePort();
+    ucHaveSeq = false;
+    ucHaveOffset = false;
+  }
+
+  if (ucHaveSeq && (int32_t)(c.seq - ucLastSeq) <= 0) return UC_OLD_SEQ;
+
+  int32_t offset = (int32_t)(now - c.sentMs);
+  if (!ucHaveOffset || offset - ucMinOffset < 0) {
+    ucMinOffset = offset;
+    ucHaveOffset = true;
+  }
+  ucHaveSeq = true;
+  ucLastSeq = c.seq;
+
+  if ((c.flags & UC_F_DEADLINE) && (uint32_t)(offset - ucMinOffset) > c.ttlMs) return UC_STALE;
+
+  if (c.sign == UC_SIGN_SD) {
+    return signShowFromSD(*ucTft, String(c.dlRef)) ? UC_OK : UC_BAD_SIGN;
+  }
+  if (c.sign >= sizeof(SIGN_TABLE) / sizeof(SIGN_TABLE[0])) return UC_BAD_SIGN;
+  signShow(*ucTft, SIGN_TABLE[c.sign]);
+  return UC_OK;
+}
+
+static void ucCount(uint8_t status, uint32_t us) {
+  switch (status) {
+    case UC_OK:         ucStats.ok++;        break;
+    case UC_STALE:      ucStats.stale++;     break;
+    case UC_OLD_SEQ:    ucStats.oldSeq++;    break;
+    case UC_BAD_SIGN:   ucStats.badSign++;   break;
+    default:            ucStats.badPacket++; break;
+  }
+  if (status != UC_OK) return;
+  uint8_t b = 0;
+  while (b < UC_HIST_N - 1 && us >= UC_HIST_US[b]) b++;
+  ucStats.hist[b]++;
+}
+
+// Из loop(): разобрать все пришедшие команды.
+static void udpControlLoop() {
+  if (!ucTft) return;
+
+  while (int size = ucUdp.parsePacket()) {
+    uint32_t t0 = micros();
+    uint32_t now = millis();
+    ucStats.rx++;
+
+    UcCmd c;
+    if (size != (int)sizeof(c) || ucUdp.read((uint8_t*)&c, sizeof(c)) != (int)sizeof(c) ||
+        c.magic[0] != 'T' || c.magic[1] != 'S' || c.ver != UC_VER) {
+      ucCount(UC_BAD_PACKET, 0);
+      continue;   // на мусор не отвечаем
+    }
+    uint8_t status = ucHandle(c, now);
+
+    uint32_t us = micros() - t0;
+    ucCount(status, us);
+
+    if (c.flags & UC_F_ACK) {
+      UcAck a = { { 'T', 'A' }, UC_VER, status, c.seq, c.sentMs, (uint16_t)min(us, (uint32_t)0xFFFF) };
+      ucUdp.beginPacket(ucUdp.remoteIP(), ucUdp.remotePort());
+      ucUdp.write((const uint8_t*)&a, sizeof(a));
+      ucUdp.endPacket();
+    }
+  }
+}
+
+// /api/udp: счётчики и гистограмма времени обработки (lt — граница корзины, мкс)
+static String udpStatsJson() {
+  String s = "{";
+  s += "\"rx\":" + String(ucStats.rx);
+  s += ",\"ok\":" + String(ucStats.ok);
+  s += ",\"stale\":" + String(ucStats.stale);
+  s += ",\"old_seq\":" + String(ucStats.oldSeq);
+  s += ",\"bad_sign\":" + String(ucStats.badSign);
+  s += ",\"bad_packet\":" + String(ucStats.badPacket);
+  s += ",\"proc_us\":[";
+  for (uint8_t i = 0; i < UC_HIST_N; i++) {
+    if (i) s += ",";
+    s += "{\"lt\":";
+    s += (i < UC_HIST_N - 1) ? String(UC_HIST_US[i]) : String("null");
+    s += ",\"n\":" + String(ucStats.hist[i]) + "}";
+  }
+  s += "]}";
+  return s;
+}
+
+static void udpControlBegin(PanelWebServer& server, Adafruit_ST7735& tft) {
+  ucTft = &tft;
+  ucUdp.begin(UDP_CONTROL_PORT);
+  server.on("/api/udp", [&](){ server.send(200, "application/json", udpStatsJson()); });
+  Serial.printf("UDP control on port %d\n", UDP_CONTROL_PORT);
+}
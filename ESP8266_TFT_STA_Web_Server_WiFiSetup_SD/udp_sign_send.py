@@ -0,0 +1,87 @@
+import argparse
+import socket
+import struct
+import time
+
+# Тестовый отправитель бинарных UDP команд (udp_control.h) + гистограмма задержки.
+#   python udp_sign_send.py --ip 192.168.1.68 --sign left --count 200 --interval 0.05
+# Задержка — от отправки до ack (включая отрисовку на панели).
+
+# Порядок = индексы SIGN_TABLE в sign_model.h
+SIGNS = ["left", "right", "back", "go", "stop", "blank",
+         "road_left", "road_right", "road_back", "road_go", "road_cross"]
+
+F_ACK, F_DEADLINE, F_RESET = 0x01, 0x02, 0x04
+SIGN_SD = 0xFF
+STATUS = ["ok", "stale", "old_seq", "bad_sign", "bad_packet"]
+
+CMD = struct.Struct("<2sBBIIHBBH")   # 18 байт
+ACK = struct.Struct("<2sBBIIH")      # 14 байт
+
+BUCKETS_MS = [1, 2, 5, 10, 20, 50, 100, 200]
+
+def histogram(rtts):
+    counts = [0] * (len(BUCKETS_MS) + 1)
+    for r in rtts:
+        i = 0
+        while i < len(BUCKETS_MS) and r >= BUCKETS_MS[i]:
+            i += 1
+        counts[i] += 1
+    top = max(counts) or 1
+    for i, n in enumerate(counts):
+        label = f"< {BUCKETS_MS[i]} ms" if i < len(BUCKETS_MS) else f">= {BUCKETS_MS[-1]} ms"
+        print(f"{label:>10} | {'#' * (n * 40 // top):<40} {n}")
+    s = sorted(rtts)
+    if s:
+        print("min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f ms" % (
+            s[0], s[len(s) // 2], s[int(len(s) * .9)], s[min(len(s) - 1, int(len(s) * .99))], s[-1]))
+
+def run(ip, port, signs, count, interval, ttl, timeout):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(timeout)
+    t0 = time.monotonic()
+    rtts, lost, status = [], 0, {}
+
+    for seq in range(1, count + 1):
+        sign = signs[(seq - 1) % len(signs)]
+        flags = F_ACK | (F_DEADLINE if ttl else 0) | (F_RESET if seq == 1 else 0)
+        sent_ms = int((time.monotonic() - t0) * 1000) & 0xFFFFFFFF
+        if sign.isdigit():
+            sid, ref = SIGN_SD, int(sign)          # /signs/<n>.sgn
+        else:
+            sid, ref = SIGNS.index(sign), 0
+        pkt = CMD.pack(b"TS", 1, flags, seq, sent_ms, ttl, sid, 0, ref)
+
+        t = time.perf_counter()
+        sock.sendto(pkt, (ip, port))
+        while True:
+            try:
+                data, _ = sock.recvfrom(64)
+            except socket.timeout:
+                lost += 1
+                break
+            if len(data) != ACK.size:
+                continue
+            magic, _, st, aseq, _, proc_us = ACK.unpack(data)
+            if magic != b"TA" or aseq != seq:
+                continue   # опоздавший ack предыдущей команды
+            rtts.append((time.perf_counter() - t) * 1000)
+            name = STATUS[st] if st < len(STATUS) else str(st)
+            status[name] = status.get(name, 0) + 1
+            break
+        time.sleep(interval)
+
+    print(f"sent {count}, acked {len(rtts)}, lost {lost}, status {status}")
+    histogram(rtts)
+
+if __name__ == "__main__":
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--ip", required=True)
+    ap.add_argument("--port", type=int, default=4210)
+    ap.add_argument("--sign", default="left,right", help="имена через запятую или номер .sgn на SD")
+    ap.add_argument("--count", type=int, default=100)
+    ap.add_argument("--interval", type=float, default=0.05, help="пауза между командами, с")
+    ap.add_argument("--ttl", type=int, default=0, help="срок годности, мс (0 — без срока)")
+    ap.add_argument("--timeout", type=float, default=0.5)
+    args = ap.parse_args()
+    run(args.ip, args.port, args.sign.split(","), args.count, args.interval, args.ttl, args.timeout)
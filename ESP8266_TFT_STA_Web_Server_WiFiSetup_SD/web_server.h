@@ -0,0 +1,70 @@
+#pragma once
+#include <ESP8266WebServer.h>
+
+// ===== Выбор веб-сервера =====
+// PANEL_ASYNC_SERVER 0 — ESP8266WebServer: один клиент за раз.
+// PANEL_ASYNC_SERVER 1 — AsyncPanelServer (async_server.h) на колбэках lwIP
+//   (ESPAsyncTCP): несколько соединений одновременно, тот же API маршрутов.
+// Модули принимают PanelWebServer&, обработчики не меняются.
+
+#ifndef PANEL_ASYNC_SERVER
+  #define PANEL_ASYNC_SERVER 0
+#endif
+
+// keep-alive: общие лимиты для обоих серверов
+#ifndef HTTP_KEEPALIVE
+  #define HTTP_KEEPALIVE 1
+#endif
+#ifndef HTTP_IDLE_MS
+  #define HTTP_IDLE_MS 1500
+#endif
+#ifndef HTTP_MAX_REQ_PER_CONN
+  #define HTTP_MAX_REQ_PER_CONN 32
+#endif
+
+// ---- зарегистрированные маршруты ----
+// Метрики и трассировка заводят слот только под путь, для которого есть
+// server.on: 404 и пробы сканеров уходят в "other" и не вытесняют
+// настоящие маршруты. Хранится FNV-1a пути — 4 байта на маршрут.
+#ifndef PANEL_ROUTES_MAX
+  #define PANEL_ROUTES_MAX 48
+#endif
+
+static uint32_t panelRouteHash[PANEL_ROUTES_MAX];
+static uint8_t  panelRouteN = 0;
+
+static uint32_t panelPathHash(const char* p, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++) { h ^= (uint8_t)p[i]; h *= 16777619u; }
+  return h;
+}
+
+static void panelRouteAdd(const String& uri) {
+  uint32_t h = panelPathHash(uri.c_str(), uri.length());
+  for (uint8_t i = 0; i < panelRouteN; i++) if (panelRouteHash[i] == h) return;
+  if (panelRouteN < PANEL_ROUTES_MAX) panelRouteHash[panelRouteN++] = h;
+}
+
+// url — как в хуке (с ?query или без).
+static bool panelRouteKnown(const String& url) {
+  int q = url.indexOf('?');
+  uint32_t h = panelPathHash(url.c_str(), q < 0 ? url.length() : (size_t)q);
+  for (uint8_t i = 0; i < panelRouteN; i++) if (panelRouteHash[i] == h) return true;
+  return false;
+}
+
+#if PANEL_ASYNC_SERVER
+  #include "async_server.h"
+  typedef AsyncPanelServer PanelWebServer;
+#else
+  // ESP8266WebServer, который запоминает пути server.on
+  class PanelSyncServer : public ESP8266WebServer {
+  public:
+    using ESP8266WebServer::ESP8266WebServer;
+    template<class... A> decltype(auto) on(const String& uri, A&&... a) {
+      panelRouteAdd(uri);
+      return ESP8266WebServer::on(uri, std::forward<A>(a)...);
+    }
+  };
+  typedef PanelSyncServer PanelWebServer;
+#endif
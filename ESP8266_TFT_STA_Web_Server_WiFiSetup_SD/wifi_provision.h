@@ -1,26 +1,17 @@
 #pragma once
 #include <ESP8266WiFi.h>
-#include <ESP8266WebServer.h>
-#include <EEPROM.h>
+#include "web_server.h"
 #include <Adafruit_ST7735.h>
 
-// ===== EEPROM layout =====
-static const int EEPROM_SIZE = 96;
-static const int SSID_ADDR   = 0;
-static const int PASS_ADDR   = 32;
+#include "trace.h"
+#include "html_template.h"
+#include "wifi_store.h"
+#include "boot_profile.h"
 
 // ===== AP setup network =====
 static const char* SETUP_AP_SSID = "ESP-Setup";
 // без пароля — чтобы точно виделось. Если хочешь пароль, добавим позже.
 
-// ---- helpers ----
-static inline void eepromClearAll() {
-  EEPROM.begin(EEPROM_SIZE);
-  for (int i = 0; i < EEPROM_SIZE; i++) EEPROM.write(i, 0);
-  EEPROM.commit();
-  EEPROM.end();
-}
-
 // ===== Reset Wi-Fi by button =====
 // Кнопка на D0 (GPIO16) -> GND. Используем INPUT_PULLUP.
 #ifndef WIFI_RESET_BTN
@@ -30,7 +21,7 @@ static inline void eepromClearAll() {
   #define WIFI_RESET_HOLD_MS 3000  // удержание 3 секунды
 #endif
 
-// Проверка удержания при старте (вызов внутри ensureWiFi)
+// Проверка удержания при старте (вызов внутри wifiProvisionBegin)
 static inline bool wifiResetPressedLong() {
   pinMode(WIFI_RESET_BTN, INPUT_PULLUP);
   if (digitalRead(WIFI_RESET_BTN) != LOW) return false;
@@ -52,7 +43,7 @@ static inline void wifiResetButtonPoll() {
   if (digitalRead(WIFI_RESET_BTN) == LOW) {
     if (pressStart == 0) pressStart = millis();
     if (millis() - pressStart >= WIFI_RESET_HOLD_MS) {
-      eepromClearAll();
+      wifiStoreClear();
       delay(200);
       ESP.restart();
     }
@@ -62,44 +53,21 @@ static inline void wifiResetButtonPoll() {
 }
 
 
-static inline void eepromWriteString(int addr, const String& s, int maxLen) {
-  // полностью затираем область (важно, чтобы не было "хвостов"!)
-  for (int i = 0; i < maxLen; i++) {
-    char c = (i < (int)s.length()) ? s[i] : 0;
-    EEPROM.write(addr + i, c);
-  }
-}
-
-static inline String eepromReadString(int addr, int maxLen) {
-  char buf[64];
-  int n = (maxLen < 63) ? maxLen : 63;
-  for (int i = 0; i < n; i++) {
-    uint8_t v = EEPROM.read(addr + i);
-    if (v == 0xFF || v == 0) { buf[i] = 0; break; }
-    buf[i] = (char)v;
-  }
-  buf[n] = 0;
-  String out(buf);
-  out.trim();
-  return out;
-}
-
-static inline void saveWiFiCreds(const String& ssid, const String& pass) {
-  EEPROM.begin(EEPROM_SIZE);
-  eepromWriteString(SSID_ADDR, ssid, 32);
-  eepromWriteString(PASS_ADDR, pass, 32);
-  EEPROM.commit();
-}
+// ===== Таймауты подключения =====
+// Быстрое подключение: BSSID, канал и IP последней удачной сети из
+// wifi_store.h — без скана и DHCP. Не вышло — один скан и известные
+// сети по убыванию RSSI, каждая не дольше WIFI_CONNECT_TIMEOUT_MS.
 
-static inline void loadWiFiCreds(String& ssid, String& pass) {
-  EEPROM.begin(EEPROM_SIZE);
-  ssid = eepromReadString(SSID_ADDR, 32);
-  pass = eepromReadString(PASS_ADDR, 32);
-}
+#ifndef WIFI_FAST_TIMEOUT_MS
+  #define WIFI_FAST_TIMEOUT_MS 3000
+#endif
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+  #define WIFI_CONNECT_TIMEOUT_MS 20000   // MGTS/некоторые роутеры — дольше коннект
+#endif
 
 // ---- UI pages ----
-static inline String wifiSetupPage() {
-  return R"rawliteral(
+// Шаблон в PROGMEM, отдаётся кусками (html_template.h)
+static const char WIFI_SETUP_HTML[] PROGMEM = R"rawliteral(
   <!doctype html><html><head>
     <meta charset="utf-8">
     <meta name="viewport" content="width=device-width,initial-scale=1">
@@ -140,16 +108,19 @@ static inline String wifiSetupPage() {
         <label>Password <small>(leave empty for open networks)</small></label>
         <input id="pass" name="p" type="password" placeholder="********" autocomplete="off">
 
-        <button type="submit" style="margin-top:14px">Save & Restart</button>
+        <button type="submit" style="margin-top:14px">Save & Connect</button>
       </form>
 
+      <label>Saved networks <small>(strongest in range is used at boot)</small></label>
+      <div id="saved"><small>…</small></div>
+
       <div class="row">
         <button type="button" class="secondary" onclick="togglePass()">Show/Hide password</button>
         <button type="button" class="secondary" onclick="location.href='/reset'">Reset Wi-Fi</button>
       </div>
 
       <div class="hint">
-        1) Connect to <b>ESP-Setup</b><br>
+        1) Connect to <b>{{ap}}</b><br>
         2) Open <b>192.168.4.1</b><br>
         3) Scan → choose SSID → enter password → Save
       </div>
@@ -161,10 +132,13 @@ static inline String wifiSetupPage() {
         sel.innerHTML = '<option>Scanning…</option>';
         try{
           const r = await fetch('/scan');
-          const arr = await r.json();
+          const res = await r.json();
+          const arr = res.nets;
+          if(!arr.length){
+            if(res.scanning){ setTimeout(scan, 1000); return; }   // первый скан ещё идёт
+            sel.innerHTML = '<option>No networks found</option>'; return;
+          }
           sel.innerHTML = '';
-          if(!arr.length){ sel.innerHTML = '<option>No networks found</option>'; return; }
-          arr.sort((a,b)=>b.rssi-a.rssi);
           for(const n of arr){
             const opt = document.createElement('option');
             const lock = n.enc ? '🔒' : '🟢';
@@ -172,6 +146,7 @@ static inline String wifiSetupPage() {
             opt.textContent = `${lock} ${n.ssid} (${n.rssi} dBm)`;
             sel.appendChild(opt);
           }
+          if(res.scanning) setTimeout(scan, 1500);                // придёт свежий список
         }catch(e){
           sel.innerHTML = '<option>Scan error</option>';
         }
@@ -180,6 +155,29 @@ static inline String wifiSetupPage() {
         const sel = document.getElementById('nets');
         document.getElementById('ssid').value = sel.value || '';
       }
+      async function loadSaved(){
+        const box = document.getElementById('saved');
+        try{
+          const arr = await (await fetch('/nets')).json();
+          box.innerHTML = arr.length ? '' : '<small>none</small>';
+          for(const n of arr){
+            const row = document.createElement('div');
+            row.className = 'row';
+            const name = document.createElement('span');
+            name.style.flex = '1';
+            name.textContent = n.ssid + (n.last ? '' : ' (never connected)');
+            const b = document.createElement('button');
+            b.type = 'button'; b.className = 'secondary'; b.style.width = 'auto';
+            b.textContent = 'Forget';
+            b.onclick = async ()=>{ await fetch('/forget?s=' + encodeURIComponent(n.ssid)); loadSaved(); };
+            row.append(name, b);
+            box.appendChild(row);
+          }
+        }catch(e){
+          box.innerHTML = '<small>error</small>';
+        }
+      }
+      loadSaved();
       function togglePass(){
         const p = document.getElementById('pass');
         p.type = (p.type === 'password') ? 'text' : 'password';
@@ -187,114 +185,434 @@ static inline String wifiSetupPage() {
     </script>
   </body></html>
   )rawliteral";
+
+static void wifiSetupVar(HtmlOut& out, const char* name) {
+  if (!strcmp(name, "ap")) out.text(SETUP_AP_SSID);
 }
 
-// ---- main entry: ensure WiFi ----
-// returns true when STA connected and app can start.
-// returns false when AP portal is running (setup mode).
-static inline bool ensureWiFi(ESP8266WebServer& server, Adafruit_ST7735& tft) {
-  // --- Сброс Wi-Fi по кнопке (D6, удерживать 3 сек) ---
-  if (wifiResetPressedLong()) {
-    eepromClearAll();
-
-    tft.fillScreen(ST77XX_BLACK);
-    tft.setTextSize(1);
-    tft.setTextColor(ST77XX_WHITE, ST77XX_BLACK);
-    tft.setCursor(0, 0);
-    tft.println("WiFi RESET");
-    tft.println("Restarting...");
+// ===== Скан сетей в фоне =====
+// WiFi.scanNetworks() в обработчике держал портал 2-4 секунды.
+// Теперь скан асинхронный (scanNetworks(true)), результат — в кэше
+// с меткой времени: без повторов SSID (лучший RSSI), по убыванию RSSI.
+// /scan отвечает из кэша сразу и запускает новый скан, только если
+// кэш старше WIFI_SCAN_TTL_MS.
 
-    delay(800);
-    ESP.restart();
+#ifndef WIFI_SCAN_MAX
+  #define WIFI_SCAN_MAX 20
+#endif
+#ifndef WIFI_SCAN_TTL_MS
+  #define WIFI_SCAN_TTL_MS 15000
+#endif
+
+struct WiFiNet {
+  char    ssid[33];
+  int8_t  rssi;
+  bool    enc;
+  uint8_t channel;      // лучшей точки сети — подключение без второго скана
+  uint8_t bssid[6];
+};
+
+static WiFiNet  wsNets[WIFI_SCAN_MAX];
+static uint8_t  wsCount = 0;
+static uint32_t wsDoneMs = 0;
+static bool     wsValid = false;      // был хотя бы один скан
+static bool     wsRunning = false;
+
+static void wifiScanStart() {
+  if (wsRunning) return;
+  WiFi.scanNetworks(true);            // async: результат через scanComplete()
+  wsRunning = true;
+}
+
+static inline bool wifiScanStale() {
+  return !wsValid || millis() - wsDoneMs > WIFI_SCAN_TTL_MS;
+}
+
+// Из loop(): забрать готовый скан в кэш.
+static void wifiScanPoll() {
+  if (!wsRunning) return;
+  int n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return;
+  wsRunning = false;
+  if (n < 0) return;                  // WIFI_SCAN_FAILED — кэш остаётся старым
+
+  wsCount = 0;
+  for (int i = 0; i < n; i++) {
+    String ssid = WiFi.SSID(i);
+    if (!ssid.length()) continue;     // скрытые сети
+    int8_t rssi = (int8_t)WiFi.RSSI(i);
+
+    // тот же SSID (несколько точек одной сети) — оставляем лучший RSSI
+    uint8_t k = 0;
+    while (k < wsCount && strcmp(wsNets[k].ssid, ssid.c_str())) k++;
+    if (k < wsCount) {
+      if (rssi <= wsNets[k].rssi) continue;
+    } else if (wsCount < WIFI_SCAN_MAX) {
+      k = wsCount++;
+    } else if (rssi > wsNets[wsCount - 1].rssi) {
+      k = wsCount - 1;                // вытесняем самую слабую
+    } else {
+      continue;
+    }
+    WiFiNet& net = wsNets[k];
+    strncpy(net.ssid, ssid.c_str(), sizeof(net.ssid) - 1);
+    net.ssid[sizeof(net.ssid) - 1] = 0;
+    net.rssi = rssi;
+    net.enc = WiFi.encryptionType(i) != ENC_TYPE_NONE;
+    net.channel = WiFi.channel(i);
+    memcpy(net.bssid, WiFi.BSSID(i), 6);
+
+    // держим список отсортированным: поднимаем запись вверх
+    while (k > 0 && wsNets[k - 1].rssi < wsNets[k].rssi) {
+      WiFiNet t = wsNets[k - 1]; wsNets[k - 1] = wsNets[k]; wsNets[k] = t;
+      k--;
+    }
   }
+  WiFi.scanDelete();
+  wsDoneMs = millis();
+  wsValid = true;
+}
 
+// ===== Подключение: автомат состояний =====
+// Ничего не ждёт в delay(): wifiProvisionBegin() в setup() только
+// запускает подключение, wifiProvisionLoop() из loop() двигает автомат.
+// Веб-сервер, SD браузер и дисплей работают с первой секунды.
+//
+//   WP_FAST    — последняя удачная сеть по кэшу (BSSID, канал, IP)  --таймаут--> WP_SCAN
+//   WP_SCAN    — один скан: известные сети в эфире, по убыванию RSSI
+//   WP_CONNECT — очередная сеть из списка, DHCP          --таймаут--> следующая / WP_PORTAL
+//   WP_STA     — подключены
+//   WP_PORTAL  — точка доступа ESP-Setup; /save сразу пробует новую сеть
+//                (точка остаётся, пока STA не подключится)
+
+enum WiFiProvState : uint8_t { WP_FAST, WP_SCAN, WP_CONNECT, WP_STA, WP_PORTAL };
+
+static WiFiProvState    wpState = WP_PORTAL;
+static Adafruit_ST7735* wpTft = nullptr;
+// Сети — по SSID, не по индексу: /forget и /save во время подключения
+// (портал ещё открыт) сдвигают и перезаписывают wifiStore.nets.
+static char             wpSsid[33] = "";   // сеть текущей попытки
+static int8_t           wpCand[WIFI_NETS_MAX];
+static uint8_t          wpCandN = 0, wpCandPos = 0;
+static uint32_t         wpStateMs = 0;     // вход в текущее состояние
+static uint32_t         wpDrawMs = 0;
+static bool             wpApOn = false;
+static bool             wpTracing = false;
+static String           wpRetry;           // /save: подключиться к этой сети
+
+static inline bool wifiPortalActive() { return wpState == WP_PORTAL || wpApOn; }
+static inline bool wifiStaReady()     { return wpState == WP_STA; }
+
+static void wpScreen(const char* title, const String& line1, const String& line2 = String()) {
+  Adafruit_ST7735& tft = *wpTft;
+  tft.fillScreen(ST77XX_BLACK);
+  tft.setTextSize(1);
+  tft.setTextColor(ST77XX_WHITE, ST77XX_BLACK);
+  tft.setCursor(0, 0);
+  tft.println(title);
+  tft.println(line1);
+  tft.println(line2);
+}
 
-  String ssid, pass;
-  loadWiFiCreds(ssid, pass);
+// Полоска прогресса под текстом: сколько прошло от таймаута состояния.
+static void wpProgress(uint32_t elapsed, uint32_t timeout, uint16_t color) {
+  if (millis() - wpDrawMs < 250) return;
+  wpDrawMs = millis();
+  int16_t w = wpTft->width();
+  int16_t done = (int16_t)min<uint32_t>(w, (uint32_t)w * elapsed / timeout);
+  wpTft->fillRect(0, 28, done, 4, color);
+  wpTft->fillRect(done, 28, w - done, 4, 0x2124);
+}
 
-  // Try STA if we have creds
-  if (ssid.length() > 1) {
-    Serial.print("Connecting to WiFi: ");
-    Serial.println(ssid);
+static void wpEnter(WiFiProvState st) {
+  static const int8_t bootStep[] = { BP_WIFI_FAST, BP_WIFI_SCAN, BP_WIFI_CONNECT, -1, BP_WIFI_PORTAL };
+  bootWifiStep(bootStep[st]);
+  wpState = st;
+  wpStateMs = millis();
+  wpDrawMs = 0;
+}
 
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid.c_str(), pass.c_str());
+static void wpTraceEnd() {
+  if (wpTracing) TRACE_END(TR_WIFI_CONNECT);
+  wpTracing = false;
+}
 
-    // MGTS/некоторые роутеры — дольше коннект, ставим 20 сек
-    unsigned long t0 = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - t0 < 20000) {
-      delay(300);
-      Serial.print(".");
-    }
-    Serial.println();
+// Начать серию попыток подключения.
+static void wpStaMode() {
+  if (!wpTracing) TRACE_BEGIN(TR_WIFI_CONNECT);
+  wpTracing = true;
+  WiFi.persistent(false);   // SDK не пишет настройки во flash на каждом begin
+  WiFi.mode(wpApOn ? WIFI_AP_STA : WIFI_STA);
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.print("Connected! IP: ");
-      Serial.println(WiFi.localIP());
+// Обычное подключение к сети i; канал и BSSID — из скана, если есть.
+static void wpConnect(int8_t i, const WiFiNet* seen) {
+  const WiFiCred& c = wifiStore.nets[i];
+  strncpy(wpSsid, c.ssid, sizeof(wpSsid) - 1);
+  Serial.printf("WiFi: connecting to '%s'%s\n", c.ssid, seen ? "" : " (not in scan)");
+  wpScreen("WiFi connecting...", c.ssid, wpApOn ? "AP stays on" : "");
+  WiFi.config(IPAddress(0u), IPAddress(0u), IPAddress(0u));   // DHCP
+  if (seen) WiFi.begin(c.ssid, c.pass, seen->channel, seen->bssid);
+  else      WiFi.begin(c.ssid, c.pass);
+  wpEnter(WP_CONNECT);
+}
 
-      tft.fillScreen(ST77XX_BLACK);
-      tft.setTextSize(1);
-      tft.setTextColor(ST77XX_WHITE, ST77XX_BLACK);
-      tft.setCursor(0, 0);
-      tft.print("IP: ");
-      tft.println(WiFi.localIP());
+// Быстрое подключение к последней удачной сети: статический IP, без скана.
+static bool wpStartFast() {
+  int i = wifiStoreMostRecent();
+  if (i < 0 || !wifiStore.nets[i].channel) return false;
+  const WiFiCred& c = wifiStore.nets[i];
+  strncpy(wpSsid, c.ssid, sizeof(wpSsid) - 1);
+  Serial.printf("WiFi: fast connect to '%s'\n", c.ssid);
+  wpScreen("WiFi connecting...", c.ssid, "fast");
+  WiFi.config(IPAddress(c.ip), IPAddress(c.gw), IPAddress(c.mask), IPAddress(c.dns));
+  WiFi.begin(c.ssid, c.pass, c.channel, c.bssid);
+  wpEnter(WP_FAST);
+  return true;
+}
 
-      return true;
-    }
+static void wpStartScan() {
+  WiFi.disconnect();
+  wpScreen("WiFi scanning...", String(wifiStore.count) + " known networks");
+  if (wifiScanStale()) wifiScanStart();
+  wpEnter(WP_SCAN);
+}
 
-    Serial.println("WiFi connect failed -> starting AP setup");
+static WiFiNet* wpSeen(const char* ssid) {
+  for (uint8_t k = 0; k < wsCount; k++) {
+    if (!strcmp(wsNets[k].ssid, ssid)) return &wsNets[k];
   }
+  return nullptr;
+}
 
-  // Start AP portal (always)
-  WiFi.mode(WIFI_AP_STA);  // важно: чтобы работал Wi-Fi scan
-  WiFi.softAP(SETUP_AP_SSID);
+static void wpStartPortal() {
+  wpTraceEnd();
+  if (!wpApOn) {
+    TRACE_BEGIN(TR_WIFI_AP);
+    WiFi.disconnect();       // STA больше не ищет сеть и не уводит канал точки
+    WiFi.mode(WIFI_AP_STA);  // важно: чтобы работал Wi-Fi scan
+    WiFi.softAP(SETUP_AP_SSID);
+    TRACE_END(TR_WIFI_AP);
+    wpApOn = true;
+
+    Serial.println("Starting AP: ESP-Setup");
+    Serial.print("AP IP: ");
+    Serial.println(WiFi.softAPIP());
+  }
+  wpEnter(WP_PORTAL);
+  wifiScanStart();           // к первому /scan список уже будет
+  wpScreen("WiFi Setup Mode", String("AP: ") + SETUP_AP_SSID, "IP: " + WiFi.softAPIP().toString());
+}
 
-  Serial.println("Starting AP: ESP-Setup");
-  Serial.print("AP IP: ");
-  Serial.println(WiFi.softAPIP());
+static void wpConnected(bool viaCache) {
+  wpTraceEnd();
+  Serial.printf("WiFi: connected to '%s' via %s in %lu ms, boot-to-connected %lu ms\n",
+                wpSsid, viaCache ? "cache" : "scan+DHCP",
+                millis() - wpStateMs, millis());
+  int i = wifiStoreFind(wpSsid);
+  if (i >= 0) wifiStoreMarkOk(i);     // сеть могли забыть, пока шло подключение
 
-  tft.fillScreen(ST77XX_BLACK);
-  tft.setTextSize(1);
-  tft.setTextColor(ST77XX_WHITE, ST77XX_BLACK);
-  tft.setCursor(0, 0);
-  tft.println("WiFi Setup Mode");
-  tft.print("AP: "); tft.println(SETUP_AP_SSID);
-  tft.print("IP: "); tft.println(WiFi.softAPIP());
+  if (wpApOn) {                  // портал больше не нужен
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_STA);
+    wpApOn = false;
+  }
+  wpEnter(WP_STA);
+
+  Serial.print("Connected! IP: ");
+  Serial.println(WiFi.localIP());
+  wpScreen("WiFi OK", wpSsid, "IP: " + WiFi.localIP().toString());
+}
 
-  server.on("/", [&](){ server.send(200, "text/html", wifiSetupPage()); });
+// ---- routes: настройка Wi-Fi ----
+static void wifiSendSetupPage(PanelWebServer& server) {
+  htmlSendTemplate(server, WIFI_SETUP_HTML, wifiSetupVar);
+}
 
+static bool wpPortalOnly(PanelWebServer& server) {
+  if (wifiPortalActive()) return true;
+  server.send(403, "text/plain", "Setup mode only");
+  return false;
+}
+
+static void wpRegisterRoutes(PanelWebServer& server) {
+  // "/" в режиме портала отдаёт app_routes (wifiSendSetupPage); здесь — прямой
+  // адрес той же страницы. Вне портала её API (/scan, /save...) отвечает 403.
+  server.on("/wifi", [&](){
+    if (!wpPortalOnly(server)) return;
+    wifiSendSetupPage(server);
+  });
+
+  // из кэша, без ожидания: {"age_ms":..,"scanning":..,"nets":[{"ssid","rssi","enc"}]}
   server.on("/scan", [&](){
-    int n = WiFi.scanNetworks();
-    String json = "[";
-    for (int i = 0; i < n; i++) {
-      if (i) json += ",";
-      String s = WiFi.SSID(i);
-      s.replace("\\", "\\\\");
-      s.replace("\"", "\\\"");
-      json += "{\"ssid\":\"" + s + "\",\"rssi\":" + String(WiFi.RSSI(i)) +
-              ",\"enc\":" + String(WiFi.encryptionType(i) != ENC_TYPE_NONE ? 1 : 0) + "}";
+    if (!wpPortalOnly(server)) return;
+    if (wifiScanStale()) wifiScanStart();
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    HtmlOut out(htmlServerSink<PanelWebServer>, &server);
+    out.raw("{\"age_ms\":");
+    out.num(wsValid ? (long)(millis() - wsDoneMs) : -1);
+    out.raw(",\"scanning\":");
+    out.raw(wsRunning ? "true" : "false");
+    out.raw(",\"nets\":[");
+    for (uint8_t i = 0; i < wsCount; i++) {
+      if (i) out.put(',');
+      out.raw("{\"ssid\":\"");
+      out.json(wsNets[i].ssid);
+      out.raw("\",\"rssi\":");
+      out.num(wsNets[i].rssi);
+      out.raw(",\"enc\":");
+      out.num(wsNets[i].enc ? 1 : 0);
+      out.put('}');
+    }
+    out.raw("]}");
+    out.flush();
+    server.sendContent("");
+  });
+
+  // известные сети (без паролей): [{"ssid","last","fast"}]
+  server.on("/nets", [&](){
+    if (!wpPortalOnly(server)) return;
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    HtmlOut out(htmlServerSink<PanelWebServer>, &server);
+    out.put('[');
+    for (uint8_t i = 0; i < wifiStore.count; i++) {
+      const WiFiCred& c = wifiStore.nets[i];
+      if (i) out.put(',');
+      out.raw("{\"ssid\":\"");
+      out.json(c.ssid);
+      out.raw("\",\"last\":");
+      out.num(c.lastOk);
+      out.raw(",\"fast\":");
+      out.raw(c.channel ? "true" : "false");
+      out.put('}');
     }
-    json += "]";
-    server.send(200, "application/json", json);
+    out.put(']');
+    out.flush();
+    server.sendContent("");
   });
 
+  // без перезагрузки: пробуем новую сеть, точка доступа остаётся до успеха
   server.on("/save", [&](){
+    if (!wpPortalOnly(server)) return;
     String s = server.arg("s"); s.trim();
     String p = server.arg("p"); p.trim();
-    saveWiFiCreds(s, p);
-    server.send(200, "text/plain", "Saved! Restarting...");
-    delay(1200);
-    ESP.restart();
+    if (s.length() < 1 || s.length() > 32 || p.length() > 63) {
+      server.send(400, "text/plain", "Bad SSID or password");
+      return;
+    }
+    wifiStoreAdd(s, p);
+    wpRetry = s;
+    server.send(200, "text/plain", "Saved! Connecting... (watch the display)");
+  });
+
+  server.on("/forget", [&](){
+    if (!wpPortalOnly(server)) return;
+    bool ok = wifiStoreForget(server.arg("s"));
+    server.send(ok ? 200 : 404, "text/plain", ok ? "OK" : "Not found");
   });
 
   // reset creds from browser
   server.on("/reset", [&](){
-    eepromClearAll();
+    if (!wpPortalOnly(server)) return;
+    wifiStoreClear();
     server.send(200, "text/plain", "WiFi cleared. Restarting...");
     delay(800);
     ESP.restart();
   });
+}
 
-  server.begin();
-  return false;
+// ---- main entry ----
+// Из setup(): кнопка сброса, маршруты настройки, старт подключения.
+// Не ждёт подключения — дальше wifiProvisionLoop().
+static void wifiProvisionBegin(PanelWebServer& server, Adafruit_ST7735& tft) {
+  wpTft = &tft;
+
+  // --- Сброс Wi-Fi по кнопке (D0, удерживать 3 сек) ---
+  TRACE_BEGIN(TR_WIFI_RESET_BTN);
+  bool resetPressed = wifiResetPressedLong();
+  TRACE_END(TR_WIFI_RESET_BTN);
+  if (resetPressed) {
+    wifiStoreClear();
+    wpScreen("WiFi RESET", "Restarting...");
+    delay(800);
+    ESP.restart();
+  }
+
+  TRACE_BEGIN(TR_WIFI_CREDS);
+  wifiStoreLoad();
+  TRACE_END(TR_WIFI_CREDS);
+
+  wpRegisterRoutes(server);
+
+  if (!wifiStore.count) { wpStartPortal(); return; }
+  wpStaMode();
+  if (!wpStartFast()) wpStartScan();
+}
+
+// Из loop(). true — один раз, в момент подключения STA
+// (запустить то, чему нужен локальный IP: UDP, multicast).
+static bool wifiProvisionLoop() {
+  uint32_t elapsed = millis() - wpStateMs;
+  wifiScanPoll();
+
+  switch (wpState) {
+    case WP_FAST:
+      if (WiFi.status() == WL_CONNECTED) { wpConnected(true); return true; }
+      wpProgress(elapsed, WIFI_FAST_TIMEOUT_MS, ST77XX_CYAN);
+      if (elapsed >= WIFI_FAST_TIMEOUT_MS) {
+        Serial.printf("WiFi: cached connect failed after %lu ms\n", elapsed);
+        wpStartScan();
+      }
+      return false;
+
+    case WP_SCAN:
+      if (wsRunning) return false;
+      // известные сети в эфире — по убыванию RSSI (wsNets уже отсортирован)
+      wpCandN = wpCandPos = 0;
+      for (uint8_t k = 0; k < wsCount; k++) {
+        int i = wifiStoreFind(wsNets[k].ssid);
+        if (i >= 0) wpCand[wpCandN++] = i;
+      }
+      Serial.printf("WiFi: %u of %u known networks in range\n", wpCandN, wifiStore.count);
+      if (!wpCandN) {
+        // скрытая сеть в скан не попадает — последняя удачная вслепую
+        wpCand[wpCandN++] = wifiStoreMostRecent();
+      }
+      wpConnect(wpCand[wpCandPos], wpSeen(wifiStore.nets[wpCand[wpCandPos]].ssid));
+      return false;
+
+    case WP_CONNECT:
+      if (WiFi.status() == WL_CONNECTED) { wpConnected(false); return true; }
+      wpProgress(elapsed, WIFI_CONNECT_TIMEOUT_MS, ST77XX_CYAN);
+      if (elapsed >= WIFI_CONNECT_TIMEOUT_MS) {
+        WiFi.disconnect();
+        if (++wpCandPos < wpCandN) {
+          wpConnect(wpCand[wpCandPos], wpSeen(wifiStore.nets[wpCand[wpCandPos]].ssid));
+          return false;
+        }
+        Serial.println("WiFi connect failed -> starting AP setup");
+        wpStartPortal();
+      }
+      return false;
+
+    case WP_PORTAL:
+      if (wpRetry.length()) {
+        int i = wifiStoreFind(wpRetry.c_str());   // могли уже забыть через /forget
+        wpRetry = "";
+        if (i < 0) return false;
+        wpCand[0] = i;
+        wpCandN = 1;
+        wpCandPos = 0;
+        wpStaMode();
+        wpConnect(wpCand[0], wpSeen(wifiStore.nets[wpCand[0]].ssid));
+      }
+      return false;
+
+    case WP_STA:
+    default:
+      return false;
+  }
 }
@@ -0,0 +1,229 @@
+#pragma once
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <EEPROM.h>
+
+// ===== Известные сети =====
+// До WIFI_NETS_MAX сетей: SSID, пароль, данные быстрого подключения
+// (BSSID, канал, IP) и номер последнего удачного подключения (lastOk:
+// больше — свежее; часов реального времени нет, поэтому счётчик).
+// Хранятся в журнале настроек (config_log.h): каждая сеть — своя запись
+// CFG_WIFI_NET0 + i, count/okSeq — CFG_WIFI_META. wifiStoreSave()
+// дописывает только изменившиеся записи.
+//
+// Старые форматы в EEPROM переносятся в журнал при первой загрузке:
+//  - WiFiStore целиком с crc32 (magic WIFI_STORE_MAGIC);
+//  - один SSID по адресу 0, пароль по 32 (начинается с печатного символа).
+//
+// Журнала нет (Flash Size без FS, cfgOk == false) — список, как раньше,
+// целиком в EEPROM форматом WiFiStore: сети не теряются при перезагрузке.
+
+#include "config_log.h"
+
+#ifndef WIFI_NETS_MAX
+  #define WIFI_NETS_MAX 4
+#endif
+
+#define WIFI_STORE_MAGIC   0xA7
+#define WIFI_STORE_VERSION 1
+
+static const int EEPROM_SIZE = 512;
+
+struct WiFiCred {
+  char     ssid[33];
+  char     pass[64];
+  uint8_t  channel;          // 0 — нет данных быстрого подключения
+  uint8_t  bssid[6];
+  uint32_t ip, gw, mask, dns;
+  uint32_t lastOk;           // 0 — ещё не подключались
+};
+
+// В RAM — весь список; в EEPROM так лежал прошлый формат.
+struct WiFiStore {
+  uint8_t  magic;
+  uint8_t  version;
+  uint8_t  count;
+  uint8_t  reserved;
+  uint32_t okSeq;            // счётчик удачных подключений
+  WiFiCred nets[WIFI_NETS_MAX];
+  uint32_t crc;
+};
+
+struct WiFiMeta {
+  uint8_t  count;
+  uint8_t  reserved[3];
+  uint32_t okSeq;
+};
+
+static_assert(sizeof(WiFiStore) <= EEPROM_SIZE, "WiFiStore does not fit EEPROM_SIZE");
+static_assert(sizeof(WiFiCred) <= CFG_REC_MAX, "WiFiCred does not fit CFG_REC_MAX");
+static_assert(CFG_WIFI_NET0 + WIFI_NETS_MAX <= CFG_DISPLAY, "WIFI_NETS_MAX overlaps other config keys");
+
+static WiFiStore wifiStore;
+
+static uint32_t wifiStoreCrc(const WiFiStore& st) {
+  return ~cfgCrc32((const uint8_t*)&st, offsetof(WiFiStore, crc));
+}
+
+static void wifiStoreReset() {
+  memset(&wifiStore, 0, sizeof(wifiStore));
+  wifiStore.magic = WIFI_STORE_MAGIC;
+  wifiStore.version = WIFI_STORE_VERSION;
+}
+
+// Без журнала: весь список в EEPROM (формат WiFiStore с crc32).
+static void wifiStoreSaveEeprom() {
+  wifiStore.crc = wifiStoreCrc(wifiStore);
+  EEPROM.begin(EEPROM_SIZE);
+  EEPROM.put(0, wifiStore);
+  EEPROM.commit();
+  EEPROM.end();
+}
+
+static void wifiStoreSave() {
+  if (!cfgOk) { wifiStoreSaveEeprom(); return; }
+  WiFiMeta m = {};
+  m.count = wifiStore.count;
+  m.okSeq = wifiStore.okSeq;
+  cfgWrite(CFG_WIFI_META, WIFI_STORE_VERSION, &m, sizeof(m));
+  for (uint8_t i = 0; i < WIFI_NETS_MAX; i++) {
+    if (i < wifiStore.count) cfgWrite(CFG_WIFI_NET0 + i, WIFI_STORE_VERSION, &wifiStore.nets[i], sizeof(WiFiCred));
+    else cfgErase(CFG_WIFI_NET0 + i);
+  }
+}
+
+// Сброс кнопкой или /reset: список в журнале и старый EEPROM.
+static void wifiStoreClear() {
+  wifiStoreReset();
+  wifiStoreSave();
+  EEPROM.begin(EEPROM_SIZE);
+  for (int i = 0; i < EEPROM_SIZE; i++) EEPROM.write(i, 0);
+  EEPROM.commit();
+  EEPROM.end();
+}
+
+// Старый формат: строка до 32 байт, 0 или 0xFF — конец.
+static void wifiStoreReadOld(int addr, char* out, size_t outSize) {
+  size_t n = 0;
+  for (int i = 0; i < 32 && n < outSize - 1; i++) {
+    uint8_t v = EEPROM.read(addr + i);
+    if (v == 0xFF || v == 0) break;
+    out[n++] = (char)v;
+  }
+  out[n] = 0;
+}
+
+// Один раз: список из EEPROM в журнал. Без журнала — при каждой
+// загрузке: чтение из EEPROM (старый формат переписывается в WiFiStore).
+static void wifiStoreMigrate() {
+  EEPROM.begin(EEPROM_SIZE);
+  EEPROM.get(0, wifiStore);
+  if (wifiStore.magic == WIFI_STORE_MAGIC && wifiStore.version == WIFI_STORE_VERSION &&
+      wifiStore.count <= WIFI_NETS_MAX && wifiStore.crc == wifiStoreCrc(wifiStore)) {
+    Serial.printf("WiFi store: %u nets %s EEPROM\n", wifiStore.count, cfgOk ? "migrated from" : "loaded from");
+    if (!cfgOk) { EEPROM.end(); return; }
+  } else {
+    char ssid[33], pass[33];
+    wifiStoreReadOld(0, ssid, sizeof(ssid));
+    wifiStoreReadOld(32, pass, sizeof(pass));
+    bool old = ssid[0] >= 0x20 && (uint8_t)ssid[0] < 0x7F && strlen(ssid) > 1;
+
+    wifiStoreReset();
+    if (old) {
+      WiFiCred& c = wifiStore.nets[0];
+      strncpy(c.ssid, ssid, sizeof(c.ssid) - 1);
+      strncpy(c.pass, pass, sizeof(c.pass) - 1);
+      wifiStore.count = 1;
+      Serial.printf("WiFi store: migrated '%s' from old layout\n", ssid);
+    }
+  }
+  EEPROM.end();
+  wifiStoreSave();   // и пустой список: META в журнале = перенос сделан
+}
+
+static void wifiStoreLoad() {
+  wifiStoreReset();
+  WiFiMeta m;
+  if (!cfgOk || !cfgRead(CFG_WIFI_META, WIFI_STORE_VERSION, &m, sizeof(m))) {
+    wifiStoreMigrate();
+    return;
+  }
+  wifiStore.okSeq = m.okSeq;
+  for (uint8_t i = 0; i < m.count && i < WIFI_NETS_MAX; i++) {
+    WiFiCred& c = wifiStore.nets[wifiStore.count];
+    if (!cfgRead(CFG_WIFI_NET0 + i, WIFI_STORE_VERSION, &c, sizeof(c))) continue;
+    c.ssid[sizeof(c.ssid) - 1] = 0;
+    c.pass[sizeof(c.pass) - 1] = 0;
+    wifiStore.count++;
+  }
+}
+
+static int wifiStoreFind(const char* ssid) {
+  for (uint8_t i = 0; i < wifiStore.count; i++) {
+    if (!strcmp(wifiStore.nets[i].ssid, ssid)) return i;
+  }
+  return -1;
+}
+
+// Последняя удачная сеть; если удачных не было — первая в списке.
+static int wifiStoreMostRecent() {
+  int best = wifiStore.count ? 0 : -1;
+  for (uint8_t i = 1; i < wifiStore.count; i++) {
+    if (wifiStore.nets[i].lastOk > wifiStore.nets[best].lastOk) best = i;
+  }
+  return best;
+}
+
+// Добавить или обновить пароль. Список полон — вытесняется самая давняя.
+static int wifiStoreAdd(const String& ssid, const String& pass) {
+  int i = wifiStoreFind(ssid.c_str());
+  if (i < 0) {
+    if (wifiStore.count < WIFI_NETS_MAX) {
+      i = wifiStore.count++;
+    } else {
+      i = 0;
+      for (uint8_t k = 1; k < wifiStore.count; k++) {
+        if (wifiStore.nets[k].lastOk < wifiStore.nets[i].lastOk) i = k;
+      }
+    }
+    memset(&wifiStore.nets[i], 0, sizeof(WiFiCred));
+    strncpy(wifiStore.nets[i].ssid, ssid.c_str(), sizeof(wifiStore.nets[i].ssid) - 1);
+  }
+  WiFiCred& c = wifiStore.nets[i];
+  if (strcmp(c.pass, pass.c_str())) {
+    memset(c.pass, 0, sizeof(c.pass));
+    strncpy(c.pass, pass.c_str(), sizeof(c.pass) - 1);
+    c.channel = 0;            // данные быстрого подключения — от старого пароля
+  }
+  wifiStoreSave();
+  return i;
+}
+
+static bool wifiStoreForget(const String& ssid) {
+  int i = wifiStoreFind(ssid.c_str());
+  if (i < 0) return false;
+  for (uint8_t k = i; k + 1 < wifiStore.count; k++) wifiStore.nets[k] = wifiStore.nets[k + 1];
+  wifiStore.count--;
+  memset(&wifiStore.nets[wifiStore.count], 0, sizeof(WiFiCred));
+  wifiStoreSave();
+  return true;
+}
+
+// После удачного подключения к сети i: запомнить точку, канал и IP.
+// Пишем, только если сменилась сеть или данные (ресурс flash).
+static void wifiStoreMarkOk(int i) {
+  WiFiCred c = wifiStore.nets[i];
+  c.channel = WiFi.channel();
+  memcpy(c.bssid, WiFi.BSSID(), 6);
+  c.ip = WiFi.localIP();
+  c.gw = WiFi.gatewayIP();
+  c.mask = WiFi.subnetMask();
+  c.dns = WiFi.dnsIP();
+
+  bool recent = c.lastOk && wifiStoreMostRecent() == i;
+  if (recent && !memcmp(&c, &wifiStore.nets[i], sizeof(c))) return;
+  if (!recent) c.lastOk = ++wifiStore.okSeq;
+  wifiStore.nets[i] = c;
+  wifiStoreSave();
+  Serial.printf("WiFi store: '%s' saved (fast-connect data)\n", c.ssid);
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+#include <WebSocketsServer.h>   // библиотека "WebSockets" (Markus Sattler)
+#include <Adafruit_ST7735.h>
+
+#include "fast_gfx.h"
+#include "sign_model.h"
+
+// ===== WebSocket канал управления =====
+// Одно постоянное соединение вместо fetch('/left') на каждое нажатие:
+// нет нового TCP, разбора HTTP и диспетчера ESP8266WebServer.
+//
+// Команды (текстовый кадр): "<seq> <op> [аргументы]"
+//   s <name>                          знак (как /api/sign?name=)
+//   f <color>                         залить экран
+//   r <x> <y> <w> <h> <color>         прямоугольник
+//   c <x> <y> <r> <color>             круг
+//   t <x0> <y0> <x1> <y1> <x2> <y2> <color>
+//   l <x0> <y0> <x1> <y1> <half> <color>   толстая линия
+//   p                                 ping (только ack — для замера задержки)
+// color — RGB565, десятичный или 0x....
+//
+// Ответы:
+//   a <seq> ok|err     подтверждение отправителю
+//   S <name>           текущий знак — всем клиентам ("" = на экране не знак)
+
+#ifndef WS_CONTROL_PORT
+  #define WS_CONTROL_PORT 81
+#endif
+
+static WebSocketsServer wsCtl(WS_CONTROL_PORT);
+static Adafruit_ST7735* wsTft = nullptr;
+static uint32_t wsSentGen = 0;
+
+static void wsSendState(int num) {
+  char msg[32];
+  snprintf(msg, sizeof(msg), "S %s", signCurrentName());
+  if (num < 0) wsCtl.broadcastTXT(msg);
+  else         wsCtl.sendTXT((uint8_t)num, msg);
+}
+
+// Разбор до n целых после команды. Возвращает число прочитанных.
+static int wsArgs(const char* p, long* v, int n) {
+  int k = 0;
+  while (k < n) {
+    char* end;
+    long x = strtol(p, &end, 0);
+    if (end == p) break;
+    v[k++] = x;
+    p = end;
+  }
+  return k;
+}
+
+// Координаты — в пределах экрана с запасом (фигура может начинаться
+// за краем), размеры и толщина — не больше экрана: растеризаторы
+// FastGfx работают в int16_t, а аргументы приходят от клиента.
+#define WS_COORD_MARGIN 160
+#define WS_HALF_MAX     64
+
+static int16_t wsX(long v) { return (int16_t)constrain(v, (long)-WS_COORD_MARGIN, (long)wsTft->width() + WS_COORD_MARGIN); }
+static int16_t wsY(long v) { return (int16_t)constrain(v, (long)-WS_COORD_MARGIN, (long)wsTft->height() + WS_COORD_MARGIN); }
+
+static bool wsExec(char op, const char* args) {
+  Adafruit_ST7735& tft = *wsTft;
+  long v[7];
+
+  if (op == 'p') return true;
+
+  if (op == 's') {
+    while (*args == ' ') args++;
+    return signShowByName(tft, String(args));
+  }
+
+  FastGfx fg(tft);
+  switch (op) {
+    case 'f':
+      if (wsArgs(args, v, 1) != 1) return false;
+      fg.fillScreen(v[0]);
+      break;
+    case 'r':
+      if (wsArgs(args, v, 5) != 5) return false;
+      fg.fillRect(wsX(v[0]), wsY(v[1]), wsX(v[2]), wsY(v[3]), v[4]);
+      break;
+    case 'c':
+      if (wsArgs(args, v, 4) != 4) return false;
+      fg.fillCircle(wsX(v[0]), wsY(v[1]), constrain(v[2], -1L, (long)FG_MAX_ROWS), v[3]);
+      break;
+    case 't':
+      if (wsArgs(args, v, 7) != 7) return false;
+      fg.fillTriangle(wsX(v[0]), wsY(v[1]), wsX(v[2]), wsY(v[3]), wsX(v[4]), wsY(v[5]), v[6]);
+      break;
+    case 'l':
+      if (wsArgs(args, v, 6) != 6) return false;
+      fg.drawThickLine(wsX(v[0]), wsY(v[1]), wsX(v[2]), wsY(v[3]),
+                       constrain(v[4], 0L, (long)WS_HALF_MAX), v[5]);
+      break;
+    default:
+      return false;
+  }
+  signInvalidate();   // поверх знака нарисовано своё
+  return true;
+}
+
+static void wsOnEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
+  switch (type) {
+    case WStype_CONNECTED:
+      Serial.printf("WS #%u connected\n", num);
+      wsSendState(num);
+      break;
+
+    case WStype_DISCONNECTED:
+      Serial.printf("WS #%u disconnected\n", num);
+      break;
+
+    case WStype_TEXT: {
+      char cmd[96];
+      if (length >= sizeof(cmd)) length = sizeof(cmd) - 1;
+      memcpy(cmd, payload, length);
+      cmd[length] = 0;
+
+      // "<seq> <op> ..."
+      char* p;
+      unsigned long seq = strtoul(cmd, &p, 10);
+      while (*p == ' ') p++;
+      char op = *p ? *p++ : 0;
+
+      bool ok = op && wsExec(op, p);
+
+      char ack[24];
+      snprintf(ack, sizeof(ack), "a %lu %s", seq, ok ? "ok" : "err");
+      wsCtl.sendTXT(num, ack);
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+static void wsControlBegin(Adafruit_ST7735& tft) {
+  wsTft = &tft;
+  wsSentGen = signGen;
+  wsCtl.begin();
+  wsCtl.onEvent(wsOnEvent);
+  Serial.printf("WS control on port %d\n", WS_CONTROL_PORT);
+}
+
+// Из loop(): обслужить клиентов и разослать смену знака
+// (в том числе сделанную через HTTP маршруты).
+static void wsControlLoop() {
+  if (!wsTft) return;
+  wsCtl.loop();
+  if (wsSentGen != signGen) {
+    wsSentGen = signGen;
+    wsSendState(-1);
+  }
+}
@@ -39,6 +39,9 @@ private:
    int mySda;
    int mySdc;
    uint8_t buffer[128 * 64 / 8];
+   // Copy of what the display RAM holds; display() only sends bytes that differ
+   uint8_t sentBuffer[128 * 64 / 8];
+   bool myNeedsFullUpdate = true;
    bool myIsFontScaling2x2 = false;
    int myFrameState = 0;
    int myFrameTick = 0;
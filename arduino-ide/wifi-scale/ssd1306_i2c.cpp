@@ -53,6 +53,7 @@ void SSD1306::resetDisplay(void)
 
 void SSD1306::reconnect() {
   Wire.begin(mySda, mySdc);  
+  myNeedsFullUpdate = true;
 }
 
 void SSD1306::displayOn(void)
@@ -73,28 +74,49 @@ void SSD1306::flipScreenVertically() {
   sendCommand(0xA0 | 0x1);      //SEGREMAP   //Rotate screen 180 deg
   
   sendCommand(0xC8);            //COMSCANDEC  Rotate screen 180 Deg
+  myNeedsFullUpdate = true;     // segment remap only applies to data written afterwards
 }
 void SSD1306::clear(void) {
     memset(buffer, 0, (128*64 / 8));
 }
 
+// Sends only what changed since the last call: per page, the column range
+// from the first to the last byte that differs from sentBuffer. A static
+// frame costs a 1 KB compare and no I2C traffic.
 void SSD1306::display(void) {
+    bool ok = true;
+    for (uint8_t page = 0; page < 8; page++) {
+      uint8_t *row = buffer + page * 128;
+      uint8_t *sent = sentBuffer + page * 128;
+      int first = 0, last = 127;
+      if (!myNeedsFullUpdate) {
+        while (first < 128 && row[first] == sent[first]) first++;
+        if (first == 128) continue;
+        while (row[last] == sent[last]) last--;
+      }
 
-    for (uint16_t i=0; i<(128*64/8); i++) {
-      // send a bunch of data in one xmission
-      //Wire.begin(mySda, mySdc);
-      Wire.beginTransmission(myI2cAddress);
-      Wire.write(0x40);
-      for (uint8_t x=0; x<16; x++) {
-        Wire.write(buffer[i]);
-        i++;
+      sendCommand(0x21);        //COLUMNADDR
+      sendCommand(first);
+      sendCommand(last);
+      sendCommand(0x22);        //PAGEADDR
+      sendCommand(page);
+      sendCommand(page);
+
+      for (int i = first; i <= last; ) {
+        // send a bunch of data in one xmission
+        Wire.beginTransmission(myI2cAddress);
+        Wire.write(0x40);
+        for (uint8_t x=0; x<16 && i <= last; x++) {
+          Wire.write(row[i]);
+          i++;
+        }
+        yield();
+        if (Wire.endTransmission() != 0) ok = false;
       }
-      i--;
-      yield();
-      Wire.endTransmission();
+      memcpy(sent + first, row + first, last - first + 1);
     }
-
-
+    // a failed transmission leaves the display RAM unknown: resend everything next time
+    myNeedsFullUpdate = !ok;
 }
 
 void SSD1306::setPixel(int x, int y) {
@@ -250,6 +272,7 @@ void SSD1306::sendInitCommands(void)
   sendCommand(0x00);            //Set Memory Addressing Mode ab Horizontal addressing mode
   // sendCommand(0x02);         // Set Memory Addressing Mode ab Page addressing mode(RESET)  
   
+  myNeedsFullUpdate = true;
 }
 
 void SSD1306::nextFrameTick() {